@@ -0,0 +1,53 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include "../utils.hpp"
+
+namespace {
+
+using CRC32Function = uint32_t (*)(uint32_t, const uint8_t*, size_t);
+
+std::vector<uint8_t> MakeBuffer(size_t size) {
+  std::mt19937 rand_gen(size);
+  std::vector<uint8_t> buffer(size);
+  for (auto& byte : buffer) {
+    byte = rand_gen();
+  }
+  return buffer;
+}
+
+void BenchCRC32(benchmark::State& state, CRC32Function crc32) {
+  if (crc32 == csma_cd::utils::CRC32Clmul &&
+      !csma_cd::utils::HasClmulCRC32()) {
+    state.SkipWithError("PCLMULQDQ is not supported");
+    return;
+  }
+  const auto buffer = MakeBuffer(state.range(0));
+  if (crc32(0, buffer.data(), buffer.size()) !=
+      csma_cd::utils::CRC32Bytewise(0, buffer.data(), buffer.size())) {
+    state.SkipWithError("checksum differs from bytewise implementation");
+    return;
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(crc32(0, buffer.data(), buffer.size()));
+  }
+  state.SetBytesProcessed(state.iterations() * buffer.size());
+}
+
+}  // namespace
+
+BENCHMARK_CAPTURE(BenchCRC32, Bytewise, csma_cd::utils::CRC32Bytewise)
+    ->Arg(64)
+    ->Arg(1500)
+    ->Arg(4 << 20);
+BENCHMARK_CAPTURE(BenchCRC32, SlicingBy8, csma_cd::utils::CRC32SlicingBy8)
+    ->Arg(64)
+    ->Arg(1500)
+    ->Arg(4 << 20);
+BENCHMARK_CAPTURE(BenchCRC32, Clmul, csma_cd::utils::CRC32Clmul)
+    ->Arg(64)
+    ->Arg(1500)
+    ->Arg(4 << 20);
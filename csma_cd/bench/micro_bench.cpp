@@ -0,0 +1,119 @@
+#include <benchmark/benchmark.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../ethernet.hpp"
+#include "../frame.hpp"
+#include "../logger.hpp"
+#include "../station.hpp"
+#include "../utils.hpp"
+
+namespace {
+
+void BenchInsertAddress(benchmark::State& state) {
+  std::array<csma_cd::Byte, 6> address{};
+  size_t id = 0;
+  for (auto _ : state) {
+    csma_cd::utils::InsertAddress(id, address);
+    benchmark::DoNotOptimize(address);
+    id = (id + 1) % csma_cd::kMaxStationsCount;
+  }
+}
+
+void BenchExtractId(benchmark::State& state) {
+  std::array<csma_cd::Byte, 6> address{0x00, 0xba, 0xba, 0x00, 0x00, 0x00};
+  csma_cd::utils::InsertAddress(123456, address);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(address);
+    benchmark::DoNotOptimize(csma_cd::utils::ExctractId(address));
+  }
+}
+
+// Frame with data of given length, checksum included
+void BenchFrame(benchmark::State& state) {
+  const std::string data(state.range(0), 'x');
+  for (auto _ : state) {
+    csma_cd::Frame frame(1, 2, data);
+    benchmark::DoNotOptimize(frame);
+  }
+}
+
+// Frame put on bus, header is decoded once
+void BenchBusFrame(benchmark::State& state) {
+  const std::string data(state.range(0), 'x');
+  for (auto _ : state) {
+    csma_cd::BusFrame bus_frame(1, 2, data, 0);
+    benchmark::DoNotOptimize(bus_frame);
+  }
+}
+
+void BenchLogFrame(benchmark::State& state) {
+  const std::chrono::nanoseconds clock(0);
+  std::vector<csma_cd::LogRecord> records;
+  csma_cd::Logger logger(clock, records);
+  const csma_cd::BusFrame bus_frame(1, 2, "data", 0);
+  for (auto _ : state) {
+    logger.LogFrame(bus_frame, 2, csma_cd::LogEvent::kReceived);
+    // Ethernet hands records to writer after every tick
+    if (records.size() == 1024) {
+      records.clear();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BenchRenderLog(benchmark::State& state) {
+  const std::string data(32, 'x');
+  const csma_cd::PayloadSource payload(
+      std::vector<csma_cd::Payload>{{1, 2, data}});
+  const csma_cd::LogRenderer renderer(1024, payload);
+  const csma_cd::LogRecord record{123456, 2, 1, 2, 0, 32,
+                                  csma_cd::LogEvent::kFinishSending, {}};
+  std::string text;
+  for (auto _ : state) {
+    renderer.Render(record, text);
+    if (text.size() > (1u << 16u)) {
+      text.clear();
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Station alternately starts and finishes sending on free bus
+void BenchStationTick(benchmark::State& state) {
+  std::ostringstream log;
+  csma_cd::EthernetConfig config;
+  config.log_format = csma_cd::LogFormat::kNone;
+  const csma_cd::Ethernet ethernet(
+      2, std::vector<csma_cd::Payload>{{0, 1, "data"}}, log, config);
+  const std::chrono::nanoseconds clock(0);
+  std::vector<csma_cd::LogRecord> records;
+  csma_cd::Logger logger(clock, records);
+  csma_cd::StationTable table(2);
+  const csma_cd::MacParams mac(config.mac);
+  csma_cd::Station station(0, table, ethernet, logger, mac,
+                           csma_cd::Random(1, 0));
+  for (auto _ : state) {
+    if (!table.has_payload[0]) {
+      station.AddPayload(0);
+    }
+    benchmark::DoNotOptimize(
+        station.ProcessTick<csma_cd::MacPolicy<
+            csma_cd::Backoff::kExponential,
+            csma_cd::Persistence::kNonPersistent>>());
+    records.clear();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+}  // namespace
+
+BENCHMARK(BenchInsertAddress);
+BENCHMARK(BenchExtractId);
+BENCHMARK(BenchFrame)->Arg(46)->Arg(1500);
+BENCHMARK(BenchBusFrame)->Arg(46)->Arg(1500);
+BENCHMARK(BenchLogFrame);
+BENCHMARK(BenchRenderLog);
+BENCHMARK(BenchStationTick);
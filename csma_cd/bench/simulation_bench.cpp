@@ -0,0 +1,122 @@
+#include <benchmark/benchmark.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../ethernet.hpp"
+
+namespace {
+
+// Payload shaped like files of tests/generate_payload.py: random sources and
+// destinations, tenth of frames is broadcast
+std::vector<csma_cd::Payload> MakePayload(size_t stations_count,
+                                          size_t frames_count,
+                                          std::string_view data) {
+  csma_cd::Random rand_gen(stations_count, frames_count);
+  std::vector<csma_cd::Payload> payload;
+  payload.reserve(frames_count);
+  for (size_t i = 0; i < frames_count; ++i) {
+    const size_t src_id = rand_gen() % stations_count;
+    const size_t dst_id =
+        rand_gen() % 10 == 0 ? stations_count : rand_gen() % stations_count;
+    payload.push_back({src_id, dst_id, data});
+  }
+  return payload;
+}
+
+void RunSimulation(benchmark::State& state, size_t stations_count,
+                   const std::vector<csma_cd::Payload>& payload,
+                   const csma_cd::EthernetConfig& config) {
+  std::ostringstream log;
+  size_t ticks = 0;
+  size_t frames = 0;
+  for (auto _ : state) {
+    auto frames_payload = payload;
+    csma_cd::Ethernet ethernet(stations_count, std::move(frames_payload), log,
+                               config);
+    while (!ethernet.IsIdle()) {
+      ethernet.ProcessEvent();
+    }
+    ticks += ethernet.GetTick();
+    frames += ethernet.GetMetrics()->GetSentFrames();
+  }
+  state.counters["ticks"] =
+      benchmark::Counter(ticks, benchmark::Counter::kIsRate);
+  state.counters["frames"] =
+      benchmark::Counter(frames, benchmark::Counter::kIsRate);
+}
+
+csma_cd::EthernetConfig MakeConfig(csma_cd::EngineMode engine_mode) {
+  csma_cd::EthernetConfig config;
+  config.engine_mode = engine_mode;
+  config.log_format = csma_cd::LogFormat::kNone;
+  config.collect_metrics = true;
+  config.seed = 1;
+  return config;
+}
+
+// Frames of 32 bytes queued at start, like payload_big.txt and
+// payload_many_stations.txt
+void BenchPayload(benchmark::State& state, csma_cd::EngineMode engine_mode) {
+  static const std::string data(32, 'x');
+  const size_t stations_count = state.range(0);
+  RunSimulation(state, stations_count,
+                MakePayload(stations_count, state.range(1), data),
+                MakeConfig(engine_mode));
+}
+
+// Poisson traffic at half of channel capacity
+void BenchTraffic(benchmark::State& state, csma_cd::EngineMode engine_mode) {
+  auto config = MakeConfig(engine_mode);
+  config.traffic.offered_load = 0.5;
+  config.traffic.duration = state.range(1);
+  RunSimulation(state, state.range(0), {}, config);
+}
+
+// Frame for every station queued at start, stations are split between
+// threads
+void BenchThreads(benchmark::State& state) {
+  static const std::string data(32, 'x');
+  const size_t stations_count = state.range(0);
+  auto config = MakeConfig(csma_cd::EngineMode::kTick);
+  config.threads_count = state.range(1);
+  RunSimulation(state, stations_count,
+                MakePayload(stations_count, stations_count, data), config);
+}
+
+void SimulationArgs(benchmark::internal::Benchmark* benchmark) {
+  for (const int64_t stations_count : {2, 8, 64, 256, 1024}) {
+    benchmark->Args({stations_count, 2000});
+  }
+  benchmark->Unit(benchmark::kMillisecond);
+}
+
+void TrafficArgs(benchmark::internal::Benchmark* benchmark) {
+  for (const int64_t stations_count : {2, 8, 64, 256, 1024}) {
+    benchmark->Args({stations_count, 100000});
+  }
+  benchmark->Unit(benchmark::kMillisecond);
+}
+
+void ThreadsArgs(benchmark::internal::Benchmark* benchmark) {
+  for (const int64_t stations_count : {1024, 16384}) {
+    for (const int64_t threads_count : {1, 2, 4}) {
+      benchmark->Args({stations_count, threads_count});
+    }
+  }
+  // Time of calling thread misses work of other threads
+  benchmark->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+
+}  // namespace
+
+BENCHMARK_CAPTURE(BenchPayload, Tick, csma_cd::EngineMode::kTick)
+    ->Apply(SimulationArgs);
+BENCHMARK_CAPTURE(BenchPayload, Event, csma_cd::EngineMode::kEvent)
+    ->Apply(SimulationArgs);
+BENCHMARK_CAPTURE(BenchTraffic, Tick, csma_cd::EngineMode::kTick)
+    ->Apply(TrafficArgs);
+BENCHMARK_CAPTURE(BenchTraffic, Event, csma_cd::EngineMode::kEvent)
+    ->Apply(TrafficArgs);
+BENCHMARK(BenchThreads)->Apply(ThreadsArgs);
@@ -0,0 +1,188 @@
+#include "capture.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace csma_cd {
+
+namespace {
+
+constexpr size_t kBufferCapacity = size_t{1} << 22u;
+constexpr size_t kBatchSize = size_t{1} << 18u;
+constexpr auto kIdleSleep = std::chrono::microseconds(200);
+
+// Block types and options of pcapng, blocks are written in native byte order
+constexpr uint32_t kSectionHeaderBlock = 0x0a0d0d0a;
+constexpr uint32_t kInterfaceDescriptionBlock = 1;
+constexpr uint32_t kEnhancedPacketBlock = 6;
+constexpr uint32_t kByteOrderMagic = 0x1a2b3c4d;
+constexpr uint16_t kLinkTypeEthernet = 1;
+constexpr uint16_t kOptionEnd = 0;
+constexpr uint16_t kOptionComment = 1;
+constexpr uint16_t kOptionUserApplication = 4;
+constexpr uint16_t kOptionInterfaceName = 2;
+constexpr uint16_t kOptionTimestampResolution = 9;
+constexpr uint16_t kOptionPacketFlags = 2;
+// Timestamps are in nanoseconds
+constexpr uint8_t kNanosecondResolution = 9;
+
+// Reception type and link-layer error bits of packet flags
+constexpr uint32_t kUnicastFlag = 1u << 2u;
+constexpr uint32_t kBroadcastFlag = 3u << 2u;
+constexpr uint32_t kCrcErrorFlag = 1u << 24u;
+
+template <typename T>
+void Append(std::string& block, T value) {
+  block.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// Values of blocks and options are padded to 32 bits
+void AppendPadded(std::string& block, std::string_view value) {
+  block += value;
+  block.append((4 - value.size() % 4) % 4, '\0');
+}
+
+void AppendOption(std::string& block, uint16_t code, std::string_view value) {
+  Append(block, code);
+  Append(block, static_cast<uint16_t>(value.size()));
+  AppendPadded(block, value);
+}
+
+void StartBlock(std::string& block, uint32_t type) {
+  block.clear();
+  Append(block, type);
+  // Length is known when block ends
+  Append(block, uint32_t{0});
+}
+
+void FinishBlock(std::string& block) {
+  const auto length = static_cast<uint32_t>(block.size() + sizeof(uint32_t));
+  std::memcpy(block.data() + sizeof(uint32_t), &length, sizeof(length));
+  Append(block, length);
+}
+
+}  // namespace
+
+CaptureWriter::CaptureWriter(std::ostream& stream, size_t snaplen)
+    : stream_(stream),
+      snaplen_(snaplen),
+      buffer_(kBufferCapacity),
+      is_stopped_(false) {
+  std::string header;
+  StartBlock(header, kSectionHeaderBlock);
+  Append(header, kByteOrderMagic);
+  Append(header, uint16_t{1});
+  Append(header, uint16_t{0});
+  // Section length is unknown
+  Append(header, int64_t{-1});
+  AppendOption(header, kOptionUserApplication, "csma-cd");
+  AppendOption(header, kOptionEnd, {});
+  FinishBlock(header);
+  stream_.write(header.data(), header.size());
+
+  StartBlock(header, kInterfaceDescriptionBlock);
+  Append(header, kLinkTypeEthernet);
+  Append(header, uint16_t{0});
+  Append(header, static_cast<uint32_t>(snaplen_));
+  AppendOption(header, kOptionInterfaceName, "bus");
+  AppendOption(header, kOptionTimestampResolution,
+               {reinterpret_cast<const char*>(&kNanosecondResolution), 1});
+  AppendOption(header, kOptionEnd, {});
+  FinishBlock(header);
+  stream_.write(header.data(), header.size());
+
+  thread_ = std::thread(&CaptureWriter::WriterLoop, this);
+}
+
+CaptureWriter::~CaptureWriter() {
+  is_stopped_.store(true, std::memory_order_release);
+  thread_.join();
+  stream_.flush();
+}
+
+void CaptureWriter::WriteFrame(std::chrono::nanoseconds clock,
+                               const BusFrame& bus_frame) {
+  // Length field is big-endian on wire
+  const Frame& frame = bus_frame.frame;
+  packet_.clear();
+  packet_.append(reinterpret_cast<const char*>(&frame.destination_address),
+                 frame.destination_address.size());
+  packet_.append(reinterpret_cast<const char*>(&frame.source_address),
+                 frame.source_address.size());
+  packet_ += static_cast<char>(frame.length >> 8u);
+  packet_ += static_cast<char>(frame.length & 0xffu);
+  packet_.append(reinterpret_cast<const char*>(frame.data.data()),
+                 frame.GetDataSize());
+
+  uint32_t flags = bus_frame.is_broadcast ? kBroadcastFlag : kUnicastFlag;
+  if (!bus_frame.is_valid) {
+    flags |= kCrcErrorFlag;
+  }
+  const size_t captured_length =
+      snaplen_ ? std::min(snaplen_, packet_.size()) : packet_.size();
+  WritePacket(clock, std::string_view(packet_).substr(0, captured_length),
+              packet_.size(), flags, {});
+}
+
+void CaptureWriter::WriteCollision(std::chrono::nanoseconds clock,
+                                   size_t frequency_rate) {
+  WritePacket(clock, {}, 0, 0,
+              "collision, rate " + std::to_string(frequency_rate) +
+                  ", bus jammed");
+}
+
+void CaptureWriter::WritePacket(std::chrono::nanoseconds clock,
+                                std::string_view data, size_t original_length,
+                                uint32_t flags, std::string_view comment) {
+  const auto timestamp = static_cast<uint64_t>(clock.count());
+  StartBlock(block_, kEnhancedPacketBlock);
+  Append(block_, uint32_t{0});
+  Append(block_, static_cast<uint32_t>(timestamp >> 32u));
+  Append(block_, static_cast<uint32_t>(timestamp));
+  Append(block_, static_cast<uint32_t>(data.size()));
+  Append(block_, static_cast<uint32_t>(original_length));
+  AppendPadded(block_, data);
+  if (flags) {
+    AppendOption(block_, kOptionPacketFlags,
+                 {reinterpret_cast<const char*>(&flags), sizeof(flags)});
+  }
+  if (!comment.empty()) {
+    AppendOption(block_, kOptionComment, comment);
+  }
+  if (flags || !comment.empty()) {
+    AppendOption(block_, kOptionEnd, {});
+  }
+  FinishBlock(block_);
+  Push(block_);
+}
+
+void CaptureWriter::Push(const std::string& block) {
+  size_t pushed = 0;
+  while (pushed < block.size()) {
+    pushed += buffer_.Push(block.data() + pushed, block.size() - pushed);
+    if (pushed < block.size()) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void CaptureWriter::WriterLoop() {
+  std::vector<char> batch(kBatchSize);
+  while (true) {
+    // Stop flag is checked before pop, so blocks pushed before stop are
+    // written
+    const bool is_stopped = is_stopped_.load(std::memory_order_acquire);
+    const size_t size = buffer_.Pop(batch.data(), batch.size());
+    if (size) {
+      stream_.write(batch.data(), size);
+      continue;
+    }
+    if (is_stopped) {
+      return;
+    }
+    std::this_thread::sleep_for(kIdleSleep);
+  }
+}
+
+}  // namespace csma_cd
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "frame.hpp"
+#include "ring_buffer.hpp"
+
+namespace csma_cd {
+
+// Writes traffic of bus as pcapng capture from background thread. Every
+// frame put on bus becomes an Ethernet packet timestamped with simulated
+// clock, collisions become empty packets with comment
+class CaptureWriter {
+ public:
+  // Frames are cut to snaplen bytes unless it is zero
+  CaptureWriter(std::ostream& stream, size_t snaplen = 0);
+
+  CaptureWriter(const CaptureWriter&) = delete;
+  CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+  // Writes all blocks left in buffer
+  ~CaptureWriter();
+
+  // Packet has no preamble and checksum, corrupted frame is marked with CRC
+  // error flag
+  void WriteFrame(std::chrono::nanoseconds clock, const BusFrame& bus_frame);
+
+  void WriteCollision(std::chrono::nanoseconds clock, size_t frequency_rate);
+
+ private:
+  void WritePacket(std::chrono::nanoseconds clock, std::string_view data,
+                   size_t original_length, uint32_t flags,
+                   std::string_view comment);
+
+  // Waits if writer thread falls behind
+  void Push(const std::string& block);
+
+  void WriterLoop();
+
+ private:
+  std::ostream& stream_;
+  const size_t snaplen_;
+  // Block being built, reused between packets
+  std::string block_;
+  std::string packet_;
+
+  RingBuffer<char> buffer_;
+  std::atomic<bool> is_stopped_;
+  std::thread thread_;
+};
+
+}  // namespace csma_cd
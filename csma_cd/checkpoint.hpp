@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <type_traits>
+
+namespace csma_cd {
+
+// Header of simulation snapshot, followed by state of bus, stations, traffic
+// and metrics
+struct CheckpointHeader {
+  static constexpr char kMagic[8] = {'C', 'S', 'M', 'A', 'C', 'K', 'P', 0};
+  static constexpr uint32_t kVersion = 2;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t stations_count;
+  // Count of loaded payload, snapshot is valid only with the same payload
+  uint64_t payload_count;
+  uint64_t tick;
+};
+
+static_assert(sizeof(CheckpointHeader) == 32, "Checkpoint layout changed");
+
+// Writes plain values of snapshot in native byte order
+class CheckpointWriter {
+ public:
+  explicit CheckpointWriter(std::ostream& stream) : stream_(stream) {}
+
+  template <typename T>
+  void Write(const T& value) {
+    WriteArray(&value, 1);
+  }
+
+  template <typename T>
+  void WriteArray(const T* values, size_t count) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    stream_.write(reinterpret_cast<const char*>(values), count * sizeof(T));
+  }
+
+ private:
+  std::ostream& stream_;
+};
+
+class CheckpointReader {
+ public:
+  explicit CheckpointReader(std::istream& stream) : stream_(stream) {}
+
+  template <typename T>
+  void Read(T& value) {
+    ReadArray(&value, 1);
+  }
+
+  template <typename T>
+  void ReadArray(T* values, size_t count) {
+    static_assert(std::is_trivially_copyable_v<T>);
+    stream_.read(reinterpret_cast<char*>(values), count * sizeof(T));
+    if (!stream_) {
+      throw std::invalid_argument("Bad checkpoint: truncated file");
+    }
+  }
+
+ private:
+  std::istream& stream_;
+};
+
+}  // namespace csma_cd
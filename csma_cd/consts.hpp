@@ -9,11 +9,23 @@ using Byte = uint8_t;
 
 static constexpr std::array<csma_cd::Byte, 6> kBroadcastAddress = {
     0x80, 0xba, 0xba, 0xff, 0xff, 0xff};
-static constexpr size_t kMaxStationsCount = 1024;
+// Station id takes 3 lower bytes of address
+static constexpr size_t kMaxStationsCount = size_t{1} << 24u;
+// Destination id of frames sent to all stations
+static constexpr size_t kBroadcastId = kMaxStationsCount;
+// Max stations count of old payload files, larger destination ids in them
+// mean broadcast
+static constexpr size_t kLegacyBroadcastId = 1024;
 static constexpr size_t kMaxSleepIncrease = 10;
 static constexpr size_t kMaxRetries = 16;
 static constexpr auto kProcessStart = std::chrono::nanoseconds(0);
-static constexpr size_t kFrameLengthInTicks = 24;  // 1526 * 8 / 512
+// Data of frame is padded to minimal length
+static constexpr size_t kMinDataLength = 46;
+static constexpr size_t kMaxDataLength = 1500;
+// Preamble, delimiter, addresses, length and checksum
+static constexpr size_t kFrameOverhead = 26;
+// Slot time at 10 Mbit/s
+static constexpr size_t kBitsPerTick = 512;
 static constexpr auto kTickDuration = std::chrono::nanoseconds(51200);
 
 }  // namespace csma_cd
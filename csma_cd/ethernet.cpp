@@ -1,107 +1,744 @@
 #include "ethernet.hpp"
 
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "profiler.hpp"
+
 namespace csma_cd {
 
-Ethernet::Ethernet(size_t stations_count, std::vector<Payload>&& payload,
-                   std::ostream& log_stream)
+namespace {
+
+// Streams of random numbers following streams of stations
+constexpr uint64_t kBusStream = kMaxStationsCount;
+constexpr uint64_t kTrafficStream = kMaxStationsCount + 1;
+
+// Generated payload in checkpoint, its data is restored from length
+struct GeneratedRecord {
+  uint64_t arrival_tick;
+  uint32_t src_id;
+  uint32_t dst_id;
+  uint32_t data_size;
+  uint32_t is_finished;
+};
+
+// Waking threads costs more than processing fewer stations per thread
+constexpr size_t kMinStationsPerThread = 256;
+
+uint64_t GetRandomSeed() {
+  std::random_device rd;
+  return (uint64_t{rd()} << 32u) | rd();
+}
+
+// Whether at least count bits of mask are set
+bool HasMarked(const std::vector<uint64_t>& mask, size_t count) {
+  size_t marked = 0;
+  for (const uint64_t word : mask) {
+    marked += __builtin_popcountll(word);
+    if (marked >= count) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+Ethernet::Ethernet(size_t stations_count, PayloadSource payload,
+                   std::ostream& log_stream, const EthernetConfig& config)
     : clock_(kProcessStart),
       is_bus_jammed_(false),
       send_timer_(0),
-      logger_(log_stream, clock_, stations_count - 1) {
+      payload_(std::move(payload)),
+      next_arrival_(0),
+      has_added_payload_(false),
+      released_generated_count_(0),
+      station_table_(stations_count),
+      logger_(clock_, log_records_),
+      config_(config),
+      mac_params_(config.mac),
+      seed_(config.seed ? *config.seed : GetRandomSeed()),
+      rand_gen_(seed_, kBusStream) {
   if (stations_count > kMaxStationsCount) {
     throw std::invalid_argument(
-        "Too many stations to create, max count is 1024");
+        "Too many stations to create, max count is " +
+        std::to_string(kMaxStationsCount));
   }
-
-  std::random_device rd;
-  for (size_t id = 0; id < stations_count; ++id) {
-    stations_.emplace_back(id, *this, rd());
+  DispatchMacPolicy(config_.mac, [this](auto policy) {
+    using Policy = decltype(policy);
+    process_stations_ = &Ethernet::ProcessStationsTick<Policy>;
+    process_stations_parallel_ = &Ethernet::ProcessStationsTickParallel<Policy>;
+  });
+  if (config_.bridge_ports_count > stations_count) {
+    throw std::invalid_argument("Bridge ports must be among stations");
   }
 
-  for (auto&& station_payload : payload) {
-    if (station_payload.src_id >= stations_.size()) {
-      throw std::invalid_argument("Bad payload: source id " +
-                                  std::to_string(station_payload.src_id) +
-                                  " points on nonexistent station");
+  if (config_.threads_count > 1) {
+    const size_t threads_count =
+        std::max<size_t>(1, std::min(config_.threads_count, stations_count));
+    // Shards own whole words of station masks
+    const auto get_shard_begin = [&](size_t i) {
+      return i == threads_count ? stations_count
+                                : stations_count * i / threads_count / 64 * 64;
+    };
+    for (size_t i = 0; i < threads_count; ++i) {
+      shards_.push_back(std::make_unique<Shard>(
+          get_shard_begin(i), get_shard_begin(i + 1), logger_));
     }
-    if (station_payload.dst_id >= stations_.size() &&
-        station_payload.dst_id < kMaxStationsCount) {
-      throw std::invalid_argument("Bad payload: destination id " +
-                                  std::to_string(station_payload.dst_id) +
-                                  " points on nonexistent station");
+    workers_ = std::make_unique<WorkerPool>(threads_count);
+  }
+
+  stations_.reserve(stations_count);
+  size_t shard = 0;
+  for (size_t id = 0; id < stations_count; ++id) {
+    // Small shards may be empty
+    while (!shards_.empty() && id == shards_[shard]->end) {
+      ++shard;
     }
-    stations_[station_payload.src_id].AddPayload(std::move(station_payload));
+    Logger& station_logger = shards_.empty() ? logger_ : shards_[shard]->logger;
+    stations_.emplace_back(id, station_table_, *this, station_logger,
+                           mac_params_, Random(seed_, id));
+  }
+
+  MarkBridgePortsActive();
+
+  if (config_.traffic.offered_load > 0) {
+    traffic_ = std::make_unique<TrafficGenerator>(
+        stations_count, config_.traffic, Random(seed_, kTrafficStream));
   }
+  if (config_.log_format != LogFormat::kNone) {
+    log_writer_ = std::make_unique<LogWriter>(log_stream, config_.log_format,
+                                              stations_count, payload_);
+  }
+  if (config_.collect_metrics) {
+    metrics_ =
+        std::make_unique<Metrics>(stations_count, mac_params_.max_retries);
+  }
+}
+
+void Ethernet::AddPayload(const Payload& payload) {
+  if (log_writer_) {
+    throw std::invalid_argument(
+        "Payload can be added only to ethernet without log");
+  }
+  if (payload.src_id >= stations_.size()) {
+    throw std::invalid_argument("Bad payload: source id " +
+                                std::to_string(payload.src_id) +
+                                " points on nonexistent station");
+  }
+  if (payload.data.size() > kMaxDataLength) {
+    throw std::invalid_argument(
+        "Bad payload: data length must be less than 1500");
+  }
+  if (payload.arrival_tick < GetTick()) {
+    throw std::invalid_argument(
+        "Bad payload: arrival tick must not be in the past");
+  }
+  const size_t dst_id = GetPayloadDst(payload.dst_id);
+  added_payload_.emplace(payload.arrival_tick, payload)->second.dst_id = dst_id;
+  has_added_payload_ = true;
 }
 
-std::optional<Frame> Ethernet::GetFrameFromBus() const { return bus_; }
+void Ethernet::SetRecordsHandler(RecordsHandler handler) {
+  records_handler_ = std::move(handler);
+}
+
+void Ethernet::SetCapture(std::ostream& stream, size_t snaplen) {
+  capture_ = std::make_unique<CaptureWriter>(stream, snaplen);
+}
+
+const BusFrame* Ethernet::GetFrameFromBus() const {
+  return bus_ ? &*bus_ : nullptr;
+}
 
 bool Ethernet::IsJammed() const { return is_bus_jammed_; }
 
 bool Ethernet::IsFree() const { return !is_bus_jammed_ && !send_timer_; }
 
 bool Ethernet::IsIdle() const {
-  if (is_bus_jammed_ || bus_) {
+  if (is_bus_jammed_ || bus_ || GetNextArrival()) {
     return false;
   }
-  return !is_bus_jammed_ && !bus_ &&
-         std::all_of(stations_.cbegin(), stations_.cend(),
-                     [](const Station& station) { return station.IsIdle(); });
+  return station_table_.IsIdle();
 }
 
 bool Ethernet::IsNewFrameStart() const {
-  return send_timer_ == kFrameLengthInTicks - 1;
+  return bus_ && send_timer_ == bus_->length_in_ticks - 1;
 }
 
-Logger& Ethernet::GetLogger() const { return logger_; }
+bool Ethernet::IsParanoidCrc() const { return config_.paranoid_crc; }
 
-void Ethernet::ProcessTick() {
-  const auto [payload, frequency_rate] = ProcessStationsTick();
+bool Ethernet::IsBridgePort(size_t id) const {
+  return id + config_.bridge_ports_count >= stations_.size();
+}
 
-  // Reset bus after jam
-  if (is_bus_jammed_) {
-    is_bus_jammed_ = false;
-    send_timer_ = 0;
+Payload Ethernet::GetPayload(size_t id) const {
+  // Generated ids follow all loaded ones, so loaded text is not indexed here
+  if (id >= next_arrival_) {
+    return generated_payload_[id - GetGeneratedBegin()].payload;
   }
-  // Reset bus after frame sending
-  if (!send_timer_ && bus_) {
-    bus_.reset();
-  }
-  // Tick timer
-  if (send_timer_) {
-    --send_timer_;
+  // Loaded payload keeps ids as they were in file
+  Payload payload = payload_.Get(id);
+  payload.dst_id = GetPayloadDst(payload.dst_id);
+  return payload;
+}
+
+size_t Ethernet::GetTick() const {
+  return (clock_ - kProcessStart) / kTickDuration;
+}
+
+const Metrics* Ethernet::GetMetrics() const { return metrics_.get(); }
+
+uint64_t Ethernet::GetSeed() const { return seed_; }
+
+void Ethernet::ProcessTick() {
+  CSMA_CD_PROFILE_TICK();
+  CSMA_CD_PROFILE_SCOPE(kTick);
+  AddArrivals();
+
+  // While nothing happens on bus only stations ready to send need processing,
+  // others just tick their sleep timers
+  const bool is_bus_event = GetBusEventDelay() == 0u;
+  if (!is_bus_event) {
+    CSMA_CD_PROFILE_SCOPE(kScan);
+    station_table_.TickSleepTimers();
   }
+  const auto [payload_id, frequency_rate] =
+      (this->*(workers_ ? process_stations_parallel_ : process_stations_))(
+          is_bus_event);
+
+  {
+    CSMA_CD_PROFILE_SCOPE(kCollision);
+    // Reset bus after jam. Nobody sends during jam, so bus becomes free
+    if (is_bus_jammed_) {
+      is_bus_jammed_ = false;
+      send_timer_ = 0;
+    }
+    // Reset bus after frame sending
+    if (!send_timer_ && bus_) {
+      bus_.reset();
+    }
+    // Tick timer
+    if (send_timer_) {
+      --send_timer_;
+    }
 
-  // Jam bus if there were collisions
-  if (frequency_rate > 1) {
-    is_bus_jammed_ = true;
+    // Jam bus if there were collisions
+    if (frequency_rate > 1) {
+      CSMA_CD_PROFILE_COUNT(kCollision, 1);
+      is_bus_jammed_ = true;
+      if (capture_) {
+        capture_->WriteCollision(clock_ - kProcessStart, frequency_rate);
+      }
+    }
   }
   // Load new payload to bus
-  if (payload) {
-    bus_ = Frame(payload->src_id, payload->dst_id, payload->data);
-    send_timer_ = kFrameLengthInTicks - 1;
+  if (payload_id) {
+    CSMA_CD_PROFILE_SCOPE(kFrame);
+    CSMA_CD_PROFILE_COUNT(kFrame, 1);
+    const Payload payload = GetPayload(*payload_id);
+    bus_.emplace(payload.src_id, payload.dst_id, payload.data, *payload_id);
+    if (config_.frame_error_rate > 0 &&
+        std::bernoulli_distribution(config_.frame_error_rate)(rand_gen_)) {
+      CorruptBusFrame();
+    }
+    // Validate frame once for all receivers
+    bus_->is_valid = bus_->IsIntact();
+    send_timer_ = bus_->length_in_ticks - 1;
+    // Frames started in collision are not transmitted
+    if (capture_ && !is_bus_jammed_) {
+      capture_->WriteFrame(clock_ - kProcessStart, *bus_);
+    }
+  }
+
+  {
+    CSMA_CD_PROFILE_SCOPE(kLog);
+    CSMA_CD_PROFILE_COUNT(kLog, log_records_.size());
+    if (metrics_) {
+      metrics_->Collect(log_records_, GetTick() + 1);
+    }
+    if (log_writer_) {
+      log_writer_->Write(log_records_);
+    }
+    if (records_handler_) {
+      records_handler_(log_records_);
+    }
+    ReleaseGeneratedPayload();
+    log_records_.clear();
   }
 
   // Tick clock
   clock_ += kTickDuration;
 }
 
-std::pair<std::optional<Payload>, size_t> Ethernet::ProcessStationsTick() {
-  std::optional<Payload> payload;
-  size_t frequency_rate = !IsFree();
+size_t Ethernet::ProcessEvent(std::optional<size_t> max_ticks) {
+  if (config_.engine_mode == EngineMode::kTick || max_ticks == 1u) {
+    ProcessTick();
+    return 1;
+  }
+  const size_t skipped_ticks =
+      SkipIdleTicks(max_ticks ? std::make_optional(*max_ticks - 1)
+                              : std::nullopt);
+  ProcessTick();
+  return skipped_ticks + 1;
+}
+
+void Ethernet::SaveCheckpoint(std::ostream& stream) const {
+  // Only length of generated payload data is saved
+  if (has_added_payload_) {
+    throw std::invalid_argument(
+        "Checkpoint of ethernet with added payload is not supported");
+  }
+  CheckpointHeader header{};
+  std::memcpy(header.magic, CheckpointHeader::kMagic, sizeof(header.magic));
+  header.version = CheckpointHeader::kVersion;
+  header.stations_count = stations_.size();
+  header.payload_count = payload_.GetSize();
+  header.tick = GetTick();
+  CheckpointWriter writer(stream);
+  writer.Write(header);
+  writer.Write(static_cast<uint8_t>(traffic_ != nullptr));
+  writer.Write(static_cast<uint8_t>(metrics_ != nullptr));
+
+  writer.Write(static_cast<uint64_t>(next_arrival_));
+  writer.Write(static_cast<uint64_t>(released_generated_count_));
+  writer.Write(static_cast<uint64_t>(generated_payload_.size()));
+  for (const auto& [payload, is_finished] : generated_payload_) {
+    writer.Write(GeneratedRecord{
+        payload.arrival_tick, static_cast<uint32_t>(payload.src_id),
+        static_cast<uint32_t>(payload.dst_id),
+        static_cast<uint32_t>(payload.data.size()), is_finished});
+  }
+
+  writer.Write(rand_gen_);
+  writer.Write(static_cast<uint8_t>(is_bus_jammed_));
+  writer.Write(static_cast<uint64_t>(send_timer_));
+  writer.Write(static_cast<uint8_t>(bus_.has_value()));
+  if (bus_) {
+    writer.Write(static_cast<uint64_t>(bus_->payload_id));
+    writer.Write(static_cast<uint8_t>(bus_->is_valid));
+    // Frame on bus may be corrupted, so its data is saved as is
+    writer.WriteArray(bus_->frame.data.data(), bus_->frame.GetDataSize());
+  }
+
+  station_table_.Save(writer);
+  for (const auto& station : stations_) {
+    station.Save(writer);
+  }
+  if (traffic_) {
+    traffic_->Save(writer);
+  }
+  if (metrics_) {
+    metrics_->Save(writer);
+  }
+}
+
+void Ethernet::LoadCheckpoint(std::istream& stream) {
+  CheckpointReader reader(stream);
+  CheckpointHeader header{};
+  reader.Read(header);
+  if (std::memcmp(header.magic, CheckpointHeader::kMagic,
+                  sizeof(header.magic)) ||
+      header.version != CheckpointHeader::kVersion) {
+    throw std::invalid_argument("Bad checkpoint: unknown format");
+  }
+  if (header.stations_count != stations_.size() ||
+      header.payload_count != payload_.GetSize()) {
+    throw std::invalid_argument(
+        "Bad checkpoint: stations count or payload does not match");
+  }
+  uint8_t has_traffic = 0;
+  uint8_t has_metrics = 0;
+  reader.Read(has_traffic);
+  reader.Read(has_metrics);
+  if (has_traffic != (traffic_ != nullptr) ||
+      has_metrics != (metrics_ != nullptr)) {
+    throw std::invalid_argument(
+        "Bad checkpoint: traffic generator or metrics do not match");
+  }
+  clock_ = kProcessStart + header.tick * kTickDuration;
+
+  uint64_t value = 0;
+  reader.Read(value);
+  if (value > payload_.GetSize()) {
+    throw std::invalid_argument("Bad checkpoint: next arrival out of payload");
+  }
+  next_arrival_ = value;
+  reader.Read(value);
+  // Queues keep 32-bit payload ids
+  if (value > UINT32_MAX) {
+    throw std::invalid_argument("Bad checkpoint: too many released frames");
+  }
+  released_generated_count_ = value;
+  reader.Read(value);
+  // Records are read one by one, so corrupted count ends with truncated file
+  // instead of huge allocation
+  generated_payload_.clear();
+  for (uint64_t i = 0; i < value; ++i) {
+    GeneratedRecord record{};
+    reader.Read(record);
+    if (record.src_id >= stations_.size() ||
+        (record.dst_id != kBroadcastId && !IsKnownStation(record.dst_id))) {
+      throw std::invalid_argument(
+          "Bad checkpoint: generated frame points on nonexistent station");
+    }
+    if (record.data_size > kMaxDataLength) {
+      throw std::invalid_argument(
+          "Bad checkpoint: generated frame data is too long");
+    }
+    generated_payload_.push_back(
+        {{record.src_id, record.dst_id, GetGeneratedData(record.data_size),
+          record.arrival_tick},
+         record.is_finished != 0});
+  }
+
+  uint8_t flag = 0;
+  reader.Read(rand_gen_);
+  reader.Read(flag);
+  is_bus_jammed_ = flag;
+  reader.Read(value);
+  send_timer_ = value;
+  reader.Read(flag);
+  bus_.reset();
+  if (flag) {
+    reader.Read(value);
+    CheckRestoredPayload(value, std::nullopt);
+    const Payload payload = GetPayload(value);
+    bus_.emplace(payload.src_id, payload.dst_id, payload.data, value);
+    reader.Read(flag);
+    bus_->is_valid = flag;
+    reader.ReadArray(bus_->frame.data.data(), bus_->frame.GetDataSize());
+  }
+
+  station_table_.Load(reader);
+  MarkBridgePortsActive();
+  for (size_t id = 0; id < stations_.size(); ++id) {
+    station_table_.payload_queues.ForEach(
+        id, [&](size_t payload_id) { CheckRestoredPayload(payload_id, id); });
+  }
   for (auto& station : stations_) {
-    auto new_payload = station.ProcessTick();
+    station.Load(reader);
+  }
+  if (traffic_) {
+    traffic_->Load(reader);
+  }
+  if (metrics_) {
+    metrics_->Load(reader);
+  }
+}
+
+template <typename Policy>
+std::pair<std::optional<size_t>, size_t> Ethernet::ProcessStationsTick(
+    bool is_bus_event) {
+  std::optional<size_t> payload_id;
+  size_t frequency_rate = !IsFree();
+  const auto process_station = [&](size_t id) {
+    const auto new_payload_id = stations_[id].template ProcessTick<Policy>();
     // After station sends frame carrier frequency increases
-    if (new_payload) {
+    if (new_payload_id) {
+      ++frequency_rate;
+      if (frequency_rate > 1) {
+        logger_.LogBusMessage(LogEvent::kCollision, frequency_rate);
+      }
+      payload_id = new_payload_id;
+    }
+  };
+
+  if (is_bus_event) {
+    ForEachBusEventStation(0, stations_.size(), process_station);
+  } else {
+    station_table_.ForEachReady(0, stations_.size(), process_station);
+  }
+  return {payload_id, frequency_rate};
+}
+
+template <typename Policy>
+std::pair<std::optional<size_t>, size_t>
+Ethernet::ProcessStationsTickParallel(bool is_bus_event) {
+  const auto process_shard = [this, is_bus_event](size_t index) {
+    auto& shard = *shards_[index];
+    const auto process_station = [&](size_t id) {
+      const auto new_payload_id = stations_[id].template ProcessTick<Policy>();
+      if (new_payload_id) {
+        shard.sent_payloads.emplace_back(shard.log_records.size(),
+                                         *new_payload_id);
+      }
+    };
+
+    if (is_bus_event) {
+      ForEachBusEventStation(shard.begin, shard.end, process_station);
+    } else {
+      station_table_.ForEachReady(shard.begin, shard.end, process_station);
+    }
+  };
+  // Shards of few stations are processed by this thread in the same order
+  const auto& mask = is_bus_event ? station_table_.active_mask
+                                  : station_table_.ready_mask;
+  if (HasMarked(mask, kMinStationsPerThread * shards_.size())) {
+    workers_->Run(process_shard);
+  } else {
+    for (size_t index = 0; index < shards_.size(); ++index) {
+      process_shard(index);
+    }
+  }
+
+  // Merge results as if stations were processed one by one
+  CSMA_CD_PROFILE_SCOPE(kCollision);
+  std::optional<size_t> payload_id;
+  size_t frequency_rate = !IsFree();
+  for (auto& shard : shards_) {
+    const auto& records = shard->log_records;
+    size_t merged_count = 0;
+    for (const auto& [sender_records_end, new_payload_id] :
+         shard->sent_payloads) {
+      log_records_.insert(log_records_.end(), records.begin() + merged_count,
+                          records.begin() + sender_records_end);
+      merged_count = sender_records_end;
+      // After station sends frame carrier frequency increases
       ++frequency_rate;
       if (frequency_rate > 1) {
-        logger_.LogBusMessage("collision,\trate " +
-                              std::to_string(frequency_rate));
+        logger_.LogBusMessage(LogEvent::kCollision, frequency_rate);
       }
-      payload = std::move(new_payload);
+      payload_id = new_payload_id;
     }
+    log_records_.insert(log_records_.end(), records.begin() + merged_count,
+                        records.end());
+    shard->log_records.clear();
+    shard->sent_payloads.clear();
+  }
+  return {payload_id, frequency_rate};
+}
+
+std::optional<size_t> Ethernet::GetBusEventDelay() const {
+  // Stations react on jam, frame start and frame end, corrupted frame is
+  // reported by stations on every tick
+  if (is_bus_jammed_ || IsNewFrameStart() || (bus_ && !bus_->is_valid)) {
+    return 0;
+  }
+  if (bus_) {
+    return send_timer_;
+  }
+  return std::nullopt;
+}
+
+void Ethernet::AddArrivals() {
+  const size_t tick = GetTick();
+  const auto add_payload = [&](size_t payload_id, const Payload& payload) {
+    stations_[payload.src_id].AddPayload(payload_id);
+    if (metrics_) {
+      metrics_->CollectArrival(payload.src_id, tick, payload.data.size());
+    }
+  };
+
+  for (; payload_.Contains(next_arrival_); ++next_arrival_) {
+    const Payload payload = payload_.Get(next_arrival_);
+    if (payload.arrival_tick > tick) {
+      break;
+    }
+    CheckArrival(next_arrival_, payload);
+    add_payload(next_arrival_, payload);
+  }
+  while (traffic_) {
+    const auto traffic_arrival = traffic_->GetNextArrival();
+    if (!traffic_arrival || *traffic_arrival > tick) {
+      break;
+    }
+    generated_payload_.push_back({traffic_->PopArrival(), false});
+    add_payload(GetGeneratedBegin() + generated_payload_.size() - 1,
+                generated_payload_.back().payload);
+  }
+  while (!added_payload_.empty() && added_payload_.begin()->first <= tick) {
+    generated_payload_.push_back({added_payload_.begin()->second, false});
+    added_payload_.erase(added_payload_.begin());
+    add_payload(GetGeneratedBegin() + generated_payload_.size() - 1,
+                generated_payload_.back().payload);
+  }
+}
+
+void Ethernet::CheckArrival(size_t payload_id, const Payload& payload) const {
+  if (payload.src_id >= stations_.size()) {
+    throw std::invalid_argument("Bad payload: source id " +
+                                std::to_string(payload.src_id) +
+                                " points on nonexistent station");
+  }
+  GetPayloadDst(payload.dst_id);
+  if (payload_id &&
+      payload.arrival_tick < payload_.GetArrivalTick(payload_id - 1)) {
+    throw std::invalid_argument(
+        "Bad payload: frames must be ordered by arrival tick");
+  }
+}
+
+size_t Ethernet::GetGeneratedBegin() const {
+  return payload_.GetSize() + released_generated_count_;
+}
+
+void Ethernet::CheckRestoredPayload(size_t payload_id,
+                                    std::optional<size_t> src_id) const {
+  const bool is_loaded = payload_id < next_arrival_;
+  const bool is_generated =
+      payload_id >= GetGeneratedBegin() &&
+      payload_id - GetGeneratedBegin() < generated_payload_.size();
+  if (!is_loaded && !is_generated) {
+    throw std::invalid_argument("Bad checkpoint: unknown payload id " +
+                                std::to_string(payload_id));
   }
-  return {payload, frequency_rate};
+  if (is_loaded) {
+    CheckArrival(payload_id, payload_.Get(payload_id));
+  }
+  if (src_id && GetPayload(payload_id).src_id != *src_id) {
+    throw std::invalid_argument("Bad checkpoint: payload id " +
+                                std::to_string(payload_id) +
+                                " is queued by wrong station");
+  }
+}
+
+void Ethernet::ReleaseGeneratedPayload() {
+  if (generated_payload_.empty()) {
+    return;
+  }
+  // Payload leaves station queue when it is sent or dropped
+  const size_t begin = GetGeneratedBegin();
+  for (const auto& record : log_records_) {
+    if ((record.event == LogEvent::kFinishSending ||
+         record.event == LogEvent::kMaxRetriesExceeded) &&
+        record.payload_id >= begin &&
+        record.payload_id - begin < generated_payload_.size()) {
+      generated_payload_[record.payload_id - begin].is_finished = true;
+    }
+  }
+  // Frame on bus is built from its payload
+  while (!generated_payload_.empty() &&
+         generated_payload_.front().is_finished &&
+         !(bus_ && bus_->payload_id == GetGeneratedBegin())) {
+    generated_payload_.pop_front();
+    ++released_generated_count_;
+  }
+}
+
+std::optional<size_t> Ethernet::GetNextArrival() const {
+  std::optional<size_t> next_arrival;
+  if (payload_.Contains(next_arrival_)) {
+    next_arrival = payload_.GetArrivalTick(next_arrival_);
+  }
+  if (traffic_) {
+    if (const auto traffic_arrival = traffic_->GetNextArrival()) {
+      next_arrival = std::min(next_arrival.value_or(*traffic_arrival),
+                              static_cast<size_t>(*traffic_arrival));
+    }
+  }
+  if (!added_payload_.empty()) {
+    const size_t added_arrival = added_payload_.begin()->first;
+    next_arrival = std::min(next_arrival.value_or(added_arrival), added_arrival);
+  }
+  return next_arrival;
+}
+
+std::optional<size_t> Ethernet::GetNextEventTick() const {
+  const size_t tick = GetTick();
+  if (config_.engine_mode == EngineMode::kTick) {
+    return tick;
+  }
+  std::optional<size_t> next_event;
+  if (const auto wakeup_delay = GetWakeupDelay(0)) {
+    next_event = tick + *wakeup_delay;
+  }
+  if (const auto bus_event_delay = GetBusEventDelay()) {
+    next_event =
+        std::min(next_event.value_or(SIZE_MAX), tick + *bus_event_delay);
+  }
+  if (const auto arrival = GetNextArrival()) {
+    next_event =
+        std::min(next_event.value_or(SIZE_MAX), std::max(tick, *arrival));
+  }
+  return next_event;
+}
+
+bool Ethernet::IsKnownStation(size_t id) const {
+  return id < std::max(stations_.size(), config_.remote_stations_end);
+}
+
+size_t Ethernet::GetPayloadDst(size_t dst_id) const {
+  if (IsKnownStation(dst_id)) {
+    return dst_id;
+  }
+  if (!IsBroadcastDst(dst_id, stations_.size())) {
+    throw std::invalid_argument("Bad payload: destination id " +
+                                std::to_string(dst_id) +
+                                " points on nonexistent station");
+  }
+  return kBroadcastId;
+}
+
+void Ethernet::MarkBridgePortsActive() {
+  // Ports are processed on every bus event as frames to remote stations have
+  // no local receiver
+  for (size_t id = stations_.size() - config_.bridge_ports_count;
+       id < stations_.size(); ++id) {
+    station_table_.active_mask[id / 64] |= uint64_t{1} << (id % 64);
+  }
+}
+
+size_t Ethernet::SkipIdleTicks(std::optional<size_t> max_ticks) {
+  const size_t tick = GetTick();
+  std::optional<size_t> next_event;
+  if (const auto bus_event_delay = GetBusEventDelay()) {
+    next_event = tick + *bus_event_delay;
+  }
+  if (const auto arrival = GetNextArrival()) {
+    next_event = std::min(next_event.value_or(SIZE_MAX), *arrival);
+  }
+  // Skipping single tick costs more than processing it
+  if (next_event && *next_event <= tick + 1) {
+    return 0;
+  }
+  {
+    CSMA_CD_PROFILE_SCOPE(kScan);
+    // Dense traffic makes some station ready almost on every tick, so scan
+    // stops on first one instead of keeping wakeups of all stations
+    if (const auto wakeup_delay = GetWakeupDelay(1)) {
+      if (*wakeup_delay <= 1) {
+        return 0;
+      }
+      next_event =
+          std::min(next_event.value_or(SIZE_MAX), tick + *wakeup_delay);
+    }
+  }
+  if (!next_event && !max_ticks) {
+    return 0;
+  }
+
+  // Nothing happens until next event except for timers ticking
+  const size_t ticks =
+      next_event ? std::min(*next_event - tick, max_ticks.value_or(SIZE_MAX))
+                 : *max_ticks;
+  {
+    CSMA_CD_PROFILE_SCOPE(kScan);
+    station_table_.SkipTicks(ticks);
+  }
+  send_timer_ -= std::min(send_timer_, ticks);
+  clock_ += ticks * kTickDuration;
+  return ticks;
+}
+
+std::optional<size_t> Ethernet::GetWakeupDelay(size_t enough_delay) const {
+  // Persistent stations ready to send wait for bus to become free, which is
+  // a bus event
+  const bool is_bus_awaited =
+      config_.mac.persistence != Persistence::kNonPersistent && !IsFree();
+  return station_table_.GetWakeupDelay(is_bus_awaited, enough_delay);
+}
+
+Ethernet::Shard::Shard(size_t begin, size_t end, const Logger& main_logger)
+    : begin(begin), end(end), logger(main_logger, log_records) {}
+
+void Ethernet::CorruptBusFrame() {
+  auto& data = bus_->frame.data;
+  std::uniform_int_distribution<size_t> bit(
+      0, bus_->frame.GetDataSize() * 8 - 1);
+  const size_t pos = bit(rand_gen_);
+  data[pos / 8] ^= 1u << (pos % 8);
 }
 
 }  // namespace csma_cd
@@ -1,19 +1,79 @@
 #pragma once
 
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
 #include <optional>
+#include <random>
 
+#include "capture.hpp"
+#include "checkpoint.hpp"
 #include "frame.hpp"
+#include "log_writer.hpp"
 #include "logger.hpp"
+#include "metrics.hpp"
+#include "payload_file.hpp"
+#include "random.hpp"
 #include "station.hpp"
+#include "traffic.hpp"
+#include "worker_pool.hpp"
 
 namespace csma_cd {
 
+enum class EngineMode {
+  kTick,   // process every tick
+  kEvent,  // skip ticks where nothing can happen
+};
+
+struct EthernetConfig {
+  EngineMode engine_mode = EngineMode::kTick;
+  // Every station checks frame checksum by itself instead of trusting verdict
+  // made by bus once per transmission
+  bool paranoid_crc = false;
+  // Probability that frame put on bus gets one of its data bits flipped
+  double frame_error_rate = 0;
+  // Stations are split between threads, result does not depend on it
+  size_t threads_count = 1;
+  LogFormat log_format = LogFormat::kText;
+  bool collect_metrics = false;
+  // Frames generated in addition to loaded payload
+  TrafficConfig traffic;
+  // Runs with the same seed and config give the same result, random seed is
+  // used if not set
+  std::optional<uint64_t> seed;
+  // Last stations are ports of bridges, they receive all frames
+  size_t bridge_ports_count = 0;
+  // Ids from stations count up to this one belong to stations behind
+  // bridges, frames to them are not broadcast
+  size_t remote_stations_end = 0;
+  // Backoff and carrier sensing of stations
+  MacConfig mac;
+};
+
 class Ethernet {
  public:
-  Ethernet(size_t stations_count, std::vector<Payload>&& payload,
-           std::ostream& log_stream);
+  using RecordsHandler = std::function<void(const std::vector<LogRecord>&)>;
+
+  // Loaded payload is checked as it arrives, so large traces start at once
+  Ethernet(size_t stations_count, PayloadSource payload,
+           std::ostream& log_stream, const EthernetConfig& config = {});
 
-  std::optional<Frame> GetFrameFromBus() const;
+  // Queues payload at its arrival tick, which must not be earlier than
+  // current tick. Data must outlive ethernet, log must be disabled as log
+  // writer cannot render such payload
+  void AddPayload(const Payload& payload);
+
+  // Handler is called with records of every processed tick on the thread
+  // processing ticks
+  void SetRecordsHandler(RecordsHandler handler);
+
+  // Writes frames put on bus and collisions as pcapng capture, stream must
+  // outlive ethernet
+  void SetCapture(std::ostream& stream, size_t snaplen = 0);
+
+  // Frame currently on bus, nullptr if bus is empty
+  const BusFrame* GetFrameFromBus() const;
 
   bool IsJammed() const;
 
@@ -23,22 +83,173 @@ class Ethernet {
 
   bool IsNewFrameStart() const;
 
-  Logger& GetLogger() const;
+  bool IsParanoidCrc() const;
+
+  bool IsBridgePort(size_t id) const;
+
+  // Generated payload has ids following ids of loaded payload, it is kept
+  // only until tick where it is sent or dropped ends
+  Payload GetPayload(size_t id) const;
+
+  // Count of processed ticks
+  size_t GetTick() const;
+
+  // Statistics of processed ticks, nullptr if not collected
+  const Metrics* GetMetrics() const;
+
+  // Seed from config or chosen randomly
+  uint64_t GetSeed() const;
 
   void ProcessTick();
 
+  // Processes next tick where something can happen, but passes no more than
+  // max ticks, returns count of passed ticks (including processed one)
+  size_t ProcessEvent(std::optional<size_t> max_ticks = std::nullopt);
+
+  // Earliest tick where something may happen, nullopt if nothing is
+  // expected. In tick mode it is always current tick
+  std::optional<size_t> GetNextEventTick() const;
+
+  // Writes state of simulation between ticks, config and log are not saved
+  void SaveCheckpoint(std::ostream& stream) const;
+
+  // Continues simulation from saved state, must be called before processing
+  // on ethernet created with the same stations count and payload
+  void LoadCheckpoint(std::istream& stream);
+
  private:
-  std::pair<std::optional<Payload>, size_t> ProcessStationsTick();
+  using ProcessStationsFunction =
+      std::pair<std::optional<size_t>, size_t> (Ethernet::*)(bool);
+
+  // Processes all stations on bus event, only ready ones otherwise, returns
+  // id of payload to send and carrier frequency rate
+  template <typename Policy>
+  std::pair<std::optional<size_t>, size_t> ProcessStationsTick(
+      bool is_bus_event);
+
+  template <typename Policy>
+  std::pair<std::optional<size_t>, size_t> ProcessStationsTickParallel(
+      bool is_bus_event);
+
+  std::optional<size_t> GetBusEventDelay() const;
+
+  // Calls function(id) for stations from [begin, end) which may act on bus
+  // event: active stations and receivers of frame on bus. Corrupted frame is
+  // reported by all stations
+  template <typename Function>
+  void ForEachBusEventStation(size_t begin, size_t end,
+                              Function function) const;
+
+  // Queues payload arriving on current tick
+  void AddArrivals();
+
+  // Checks loaded payload reaching its arrival tick
+  void CheckArrival(size_t payload_id, const Payload& payload) const;
+
+  // Id of first generated payload which is still kept, indexes loaded text
+  // to its end
+  size_t GetGeneratedBegin() const;
+
+  // Checks that restored payload id refers to payload which arrived and is
+  // kept, and that payload belongs to given station
+  void CheckRestoredPayload(size_t payload_id,
+                            std::optional<size_t> src_id) const;
+
+  // Frees generated payload which was sent or dropped by stations
+  void ReleaseGeneratedPayload();
+
+  std::optional<size_t> GetNextArrival() const;
+
+  bool IsKnownStation(size_t id) const;
+
+  // Destination id of payload on bus, throws if it points on nonexistent
+  // station
+  size_t GetPayloadDst(size_t dst_id) const;
+
+  void MarkBridgePortsActive();
+
+  size_t SkipIdleTicks(std::optional<size_t> max_ticks);
+  // Count of ticks after which some station acts regardless of bus events,
+  // exact if not above enough_delay
+  std::optional<size_t> GetWakeupDelay(size_t enough_delay) const;
+
+  void CorruptBusFrame();
 
  private:
   std::chrono::nanoseconds clock_;
 
-  std::optional<Frame> bus_;
+  std::optional<BusFrame> bus_;
   bool is_bus_jammed_;
   size_t send_timer_;
 
+  // Loaded payload ordered by arrival, log writer reads it from another
+  // thread. Records before next arrival are checked
+  PayloadSource payload_;
+  size_t next_arrival_;
+  std::unique_ptr<TrafficGenerator> traffic_;
+  // Payload added after start by arrival tick, equal ticks keep order
+  std::multimap<uint64_t, Payload> added_payload_;
+  bool has_added_payload_;
+  struct GeneratedPayload {
+    Payload payload;
+    bool is_finished;
+  };
+
+  // Generated and added payload in order of arrival, finished payload is
+  // removed from front, so memory does not grow with simulated time
+  std::deque<GeneratedPayload> generated_payload_;
+  size_t released_generated_count_;
+  // Records of current tick, passed to writer when tick ends
+  std::vector<LogRecord> log_records_;
+  std::unique_ptr<LogWriter> log_writer_;
+  std::unique_ptr<Metrics> metrics_;
+  RecordsHandler records_handler_;
+  std::unique_ptr<CaptureWriter> capture_;
+
+  // Stations range processed by one thread, its log is buffered and merged
+  // into main log in the order of station ids
+  struct Shard {
+    Shard(size_t begin, size_t end, const Logger& main_logger);
+
+    size_t begin;
+    size_t end;
+    std::vector<LogRecord> log_records;
+    Logger logger;
+    // Ids of payloads sent in tick with counts of records before their
+    // senders finished
+    std::vector<std::pair<size_t, size_t>> sent_payloads;
+  };
+
+  StationTable station_table_;
   std::vector<Station> stations_;
-  mutable Logger logger_;
+  Logger logger_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::unique_ptr<WorkerPool> workers_;
+
+  const EthernetConfig config_;
+  const MacParams mac_params_;
+  // Specializations for MAC policy of config, chosen once
+  ProcessStationsFunction process_stations_;
+  ProcessStationsFunction process_stations_parallel_;
+  const uint64_t seed_;
+  Random rand_gen_;
 };
 
+template <typename Function>
+void Ethernet::ForEachBusEventStation(size_t begin, size_t end,
+                                      Function function) const {
+  if (bus_ && !is_bus_jammed_ && (bus_->is_broadcast || !bus_->is_valid)) {
+    for (size_t id = begin; id < end; ++id) {
+      function(id);
+    }
+    return;
+  }
+  std::optional<size_t> receiver;
+  if (bus_ && !is_bus_jammed_ && bus_->dst_id &&
+      *bus_->dst_id < stations_.size()) {
+    receiver = bus_->dst_id;
+  }
+  station_table_.ForEachActive(begin, end, receiver, function);
+}
+
 }  // namespace csma_cd
@@ -1,18 +1,21 @@
 #include "frame.hpp"
 
-#include <string>
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
 
+#include "profiler.hpp"
 #include "utils.hpp"
 
 namespace csma_cd {
 
-Frame::Frame(size_t src_id, size_t dst_id, const std::string& payload_data)
+Frame::Frame(size_t src_id, size_t dst_id, std::string_view payload_data)
     : preamble({0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa}),
       start_of_frame_delim(0xab),
       destination_address({0x00, 0xba, 0xba, 0x00, 0x00, 0x00}),
       source_address({0x00, 0xba, 0xba, 0x00, 0x00, 0x00}),
-      data({0}),
-      length(1500) {
+      length(std::min(payload_data.size(), kMaxDataLength)) {
   /* address:
    * first bit - 1 if address is broadcast
    * second bit - 1 if local, 0 if centralized
@@ -25,11 +28,43 @@ Frame::Frame(size_t src_id, size_t dst_id, const std::string& payload_data)
   utils::InsertAddress(src_id, source_address);
   utils::InsertAddress(dst_id, destination_address);
 
-  std::strcpy(reinterpret_cast<char*>(data.data()), payload_data.data());
+  // Only sent bytes are written, short data is padded with zeros
+  std::memcpy(data.data(), payload_data.data(), length);
+  std::memset(data.data() + length, 0, GetDataSize() - length);
 
-  // CRC-32 checksum of whole frame (except for checksum field)
-  checksum = utils::CRC32(0, reinterpret_cast<const uint8_t*>(this),
-                          sizeof(*this) - 4);
+  checksum = ComputeChecksum();
+}
+
+size_t Frame::GetDataSize() const {
+  return std::max<size_t>(length, kMinDataLength);
+}
+
+uint32_t Frame::ComputeChecksum() const {
+  CSMA_CD_PROFILE_SCOPE(kCrc);
+  CSMA_CD_PROFILE_COUNT(kCrc, 1);
+  return utils::CRC32(0, reinterpret_cast<const uint8_t*>(this),
+                      offsetof(Frame, data) + GetDataSize());
+}
+
+size_t GetFrameLengthInTicks(size_t data_length) {
+  const size_t bits =
+      (kFrameOverhead + std::max(data_length, kMinDataLength)) * 8;
+  return (bits + kBitsPerTick - 1) / kBitsPerTick;
+}
+
+BusFrame::BusFrame(size_t src_id, size_t dst_id, std::string_view payload_data,
+                   size_t payload_id)
+    : frame(src_id, dst_id, payload_data),
+      payload_id(payload_id),
+      src_id(utils::ExctractId(frame.source_address)),
+      dst_id(utils::ExctractId(frame.destination_address)),
+      is_broadcast(this->dst_id && (frame.destination_address[0] >> 7u)),
+      length_in_ticks(GetFrameLengthInTicks(frame.length)),
+      is_valid(true) {}
+
+bool BusFrame::IsIntact() const {
+  return frame.start_of_frame_delim == 0xab &&
+         frame.ComputeChecksum() == frame.checksum;
 }
 
 }  // namespace csma_cd
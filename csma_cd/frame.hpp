@@ -1,20 +1,53 @@
 #pragma once
 
 #include <array>
+#include <optional>
+#include <string_view>
 
 #include "consts.hpp"
 
 namespace csma_cd {
 
 struct Frame {
-  Frame(size_t src_id, size_t dst_id, const std::string& task_data);
+  Frame(size_t src_id, size_t dst_id, std::string_view payload_data);
+
+  // Count of data bytes sent on wire including padding
+  size_t GetDataSize() const;
+
+  // CRC-32 checksum of sent bytes before checksum field
+  uint32_t ComputeChecksum() const;
+
   [[maybe_unused]] std::array<Byte, 7> preamble;
   Byte start_of_frame_delim;
   std::array<Byte, 6> destination_address;
   std::array<Byte, 6> source_address;
-  [[maybe_unused]] uint16_t length;
-  std::array<Byte, 1500> data;
+  // Length of payload data without padding
+  uint16_t length;
+  // Only sent bytes are initialized
+  std::array<Byte, kMaxDataLength> data;
   uint32_t checksum;
 };
 
+// Ticks taken by frame with data of given length on bus
+size_t GetFrameLengthInTicks(size_t data_length);
+
+// Frame on bus with its header decoded once when frame is put on bus
+struct BusFrame {
+  BusFrame(size_t src_id, size_t dst_id, std::string_view payload_data,
+           size_t payload_id);
+
+  // Checks frame delimiter and checksum
+  bool IsIntact() const;
+
+  Frame frame;
+  // Index of payload carried by frame
+  size_t payload_id;
+  std::optional<size_t> src_id;
+  std::optional<size_t> dst_id;
+  bool is_broadcast;
+  size_t length_in_ticks;
+  // Verdict of integrity check made by bus
+  bool is_valid;
+};
+
 }  // namespace csma_cd
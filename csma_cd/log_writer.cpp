@@ -0,0 +1,113 @@
+#include "log_writer.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#include "payload_file.hpp"
+
+namespace csma_cd {
+
+namespace {
+
+constexpr size_t kBufferCapacity = 1u << 16u;
+constexpr size_t kBatchSize = 4096;
+constexpr auto kIdleSleep = std::chrono::microseconds(200);
+
+}  // namespace
+
+LogWriter::LogWriter(std::ostream& log_stream, LogFormat format,
+                     size_t stations_count, const PayloadSource& payload)
+    : log_stream_(log_stream),
+      format_(format),
+      renderer_(stations_count, payload),
+      buffer_(kBufferCapacity),
+      is_stopped_(false) {
+  if (format_ == LogFormat::kBinary) {
+    LogHeader header{};
+    std::memcpy(header.magic, LogHeader::kMagic, sizeof(header.magic));
+    header.version = LogHeader::kVersion;
+    header.stations_count = stations_count;
+    header.payload_count = payload.GetSize();
+    log_stream_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+  thread_ = std::thread(&LogWriter::WriterLoop, this);
+}
+
+LogWriter::~LogWriter() {
+  is_stopped_.store(true, std::memory_order_release);
+  thread_.join();
+  log_stream_.flush();
+}
+
+void LogWriter::Write(const std::vector<LogRecord>& records) {
+  size_t pushed = 0;
+  while (pushed < records.size()) {
+    pushed += buffer_.Push(records.data() + pushed, records.size() - pushed);
+    if (pushed < records.size()) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+void LogWriter::WriterLoop() {
+  std::vector<LogRecord> batch(kBatchSize);
+  while (true) {
+    // Stop flag is checked before pop, so records pushed before stop are
+    // written
+    const bool is_stopped = is_stopped_.load(std::memory_order_acquire);
+    const size_t size = buffer_.Pop(batch.data(), batch.size());
+    if (size) {
+      WriteBatch(batch.data(), size);
+      continue;
+    }
+    if (is_stopped) {
+      return;
+    }
+    log_stream_.flush();
+    std::this_thread::sleep_for(kIdleSleep);
+  }
+}
+
+void LogWriter::WriteBatch(const LogRecord* records, size_t size) {
+  if (format_ == LogFormat::kBinary) {
+    log_stream_.write(reinterpret_cast<const char*>(records),
+                      size * sizeof(LogRecord));
+    return;
+  }
+  text_.clear();
+  for (size_t i = 0; i < size; ++i) {
+    renderer_.Render(records[i], text_);
+  }
+  log_stream_.write(text_.data(), text_.size());
+}
+
+void RenderBinaryLog(std::istream& binary_log,
+                     const PayloadSource& payload,
+                     std::ostream& text_log) {
+  LogHeader header{};
+  binary_log.read(reinterpret_cast<char*>(&header), sizeof(header));
+  if (!binary_log ||
+      std::memcmp(header.magic, LogHeader::kMagic, sizeof(header.magic)) ||
+      header.version != LogHeader::kVersion) {
+    throw std::invalid_argument("Bad binary log: unknown format");
+  }
+  if (header.payload_count != payload.GetSize()) {
+    throw std::invalid_argument("Bad binary log: payload does not match log");
+  }
+
+  const LogRenderer renderer(header.stations_count, payload);
+  std::vector<LogRecord> batch(kBatchSize);
+  std::string text;
+  while (binary_log) {
+    binary_log.read(reinterpret_cast<char*>(batch.data()),
+                    batch.size() * sizeof(LogRecord));
+    const size_t size = binary_log.gcount() / sizeof(LogRecord);
+    text.clear();
+    for (size_t i = 0; i < size; ++i) {
+      renderer.Render(batch[i], text);
+    }
+    text_log.write(text.data(), text.size());
+  }
+}
+
+}  // namespace csma_cd
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <istream>
+#include <ostream>
+#include <thread>
+
+#include "logger.hpp"
+#include "ring_buffer.hpp"
+
+namespace csma_cd {
+
+enum class LogFormat {
+  kText,    // human-readable lines
+  kBinary,  // header followed by raw log records
+  kNone,    // records are only collected into metrics
+};
+
+// Header of binary log
+struct LogHeader {
+  static constexpr char kMagic[8] = {'C', 'S', 'M', 'A', 'L', 'O', 'G', 0};
+  static constexpr uint32_t kVersion = 2;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t stations_count;
+  // Count of loaded payload, records with greater ids refer generated payload
+  uint64_t payload_count;
+};
+
+// Writes records to stream from background thread
+class LogWriter {
+ public:
+  LogWriter(std::ostream& log_stream, LogFormat format, size_t stations_count,
+            const PayloadSource& payload);
+
+  LogWriter(const LogWriter&) = delete;
+  LogWriter& operator=(const LogWriter&) = delete;
+
+  // Writes all records left in buffer
+  ~LogWriter();
+
+  // Waits if writer thread falls behind
+  void Write(const std::vector<LogRecord>& records);
+
+ private:
+  void WriterLoop();
+
+  void WriteBatch(const LogRecord* records, size_t size);
+
+ private:
+  std::ostream& log_stream_;
+  const LogFormat format_;
+  const LogRenderer renderer_;
+  std::string text_;
+
+  RingBuffer<LogRecord> buffer_;
+  std::atomic<bool> is_stopped_;
+  std::thread thread_;
+};
+
+// Renders binary log written by LogWriter as text
+void RenderBinaryLog(std::istream& binary_log,
+                     const PayloadSource& payload,
+                     std::ostream& text_log);
+
+}  // namespace csma_cd
@@ -1,83 +1,182 @@
 #include "logger.hpp"
 
-#include <iomanip>
-
+#include "consts.hpp"
 #include "frame.hpp"
+#include "payload_file.hpp"
 #include "station.hpp"
-#include "utils.hpp"
+#include "traffic.hpp"
 
 namespace csma_cd {
 
-Logger::Logger(std::ostream& log_stream, const std::chrono::nanoseconds& clock,
-               size_t max_id)
-    : log_stream_(log_stream),
-      clock_(clock),
-      id_width_(std::to_string(max_id).size()) {}
-
-void Logger::LogPayload(const csma_cd::Payload& payload, size_t station_id,
-                        const std::string& message) {
-  LogClock();
-  LogStation(station_id);
-  log_stream_ << ":\t" << message << ",\tsource = ";
-  LogStation(payload.src_id);
-  log_stream_ << ",\tdestination = ";
-  LogStation(payload.dst_id);
-  log_stream_ << ",\tdata = \"" << payload.data << "\"" << std::endl;
+namespace {
+
+const char* GetEventMessage(LogEvent event) {
+  switch (event) {
+    case LogEvent::kStartSending:
+      return "start sending frame";
+    case LogEvent::kFinishSending:
+      return "finish sending frame";
+    case LogEvent::kMaxRetriesExceeded:
+      return "max retries exceeded while sending frame";
+    case LogEvent::kStartReceiving:
+      return "start receiving frame";
+    case LogEvent::kReceived:
+      return "successfully received frame";
+    case LogEvent::kMissed:
+      return "!!! missed frame";
+    case LogEvent::kRetry:
+      return "retry count = ";
+    case LogEvent::kNothingToSend:
+      return "nothing left to send";
+    case LogEvent::kReceiveInterrupt:
+      return "!!! frame receive interrupt";
+    case LogEvent::kCorruptedFrame:
+      return "!!! received corrupted frame";
+    case LogEvent::kCollision:
+      return "collision,\trate ";
+  }
+  return "";
 }
 
-void Logger::LogFrame(const Frame& frame, size_t station_id,
-                      const std::string& message) {
-  const auto src_id = utils::ExctractId(frame.source_address);
-  const auto dst_id = utils::ExctractId(frame.destination_address);
-  if (src_id && dst_id) {
-    Payload payload{
-        *src_id, *dst_id,
-        std::string(reinterpret_cast<const char*>(frame.data.data()))};
-    LogPayload(payload, station_id, message);
-  } else {
-    LogClock();
-    LogStation(station_id);
-    log_stream_ << ":\t!!! corrupted frame,\tmissed message = \"" << message
-                << "\"" << std::endl;
+void AppendPadded(uint64_t value, size_t width, char fill, std::string& text) {
+  const std::string digits = std::to_string(value);
+  if (digits.size() < width) {
+    text.append(width - digits.size(), fill);
   }
+  text += digits;
+}
+
+}  // namespace
+
+Logger::Logger(const std::chrono::nanoseconds& clock,
+               std::vector<LogRecord>& records)
+    : clock_(clock), records_(records) {}
+
+Logger::Logger(const Logger& other, std::vector<LogRecord>& records)
+    : clock_(other.clock_), records_(records) {}
+
+void Logger::LogPayload(const csma_cd::Payload& payload, size_t payload_id,
+                        size_t station_id, LogEvent event) {
+  records_.push_back({GetTick(), static_cast<uint32_t>(station_id),
+                      static_cast<uint32_t>(payload.src_id),
+                      static_cast<uint32_t>(payload.dst_id),
+                      static_cast<uint32_t>(payload_id),
+                      static_cast<uint32_t>(payload.data.size()), event, {}});
 }
 
-void Logger::LogMessage(size_t station_id, const std::string& message) {
-  LogClock();
-  LogStation(station_id);
-  log_stream_ << ":\t" << message << std::endl;
+void Logger::LogFrame(const BusFrame& bus_frame, size_t station_id,
+                      LogEvent event) {
+  const auto src_id = bus_frame.src_id && bus_frame.dst_id
+                          ? static_cast<uint32_t>(*bus_frame.src_id)
+                          : LogRecord::kUnknownId;
+  const auto dst_id = bus_frame.src_id && bus_frame.dst_id
+                          ? static_cast<uint32_t>(*bus_frame.dst_id)
+                          : LogRecord::kUnknownId;
+  records_.push_back({GetTick(), static_cast<uint32_t>(station_id), src_id,
+                      dst_id, static_cast<uint32_t>(bus_frame.payload_id),
+                      bus_frame.frame.length, event, {}});
 }
 
-void Logger::LogBusMessage(const std::string& message) {
-  LogClock();
-  log_stream_ << "-- bus --:\t" << message << std::endl;
+void Logger::LogMessage(size_t station_id, LogEvent event, size_t value) {
+  records_.push_back({GetTick(), static_cast<uint32_t>(station_id),
+                      LogRecord::kUnknownId, LogRecord::kUnknownId,
+                      LogRecord::kUnknownId, static_cast<uint32_t>(value),
+                      event, {}});
+}
+
+void Logger::LogBusMessage(LogEvent event, size_t value) {
+  LogMessage(LogRecord::kUnknownId, event, value);
+}
+
+uint64_t Logger::GetTick() const {
+  return (clock_ - kProcessStart) / kTickDuration;
+}
+
+LogRenderer::LogRenderer(size_t stations_count,
+                         const PayloadSource& payload)
+    : id_width_(std::to_string(stations_count - 1).size()), payload_(payload) {}
+
+void LogRenderer::Render(const LogRecord& record, std::string& text) const {
+  RenderClock(record.tick, text);
+  switch (record.event) {
+    case LogEvent::kCollision:
+      text += "-- bus --:\t";
+      text += GetEventMessage(record.event);
+      text += std::to_string(record.value);
+      break;
+    case LogEvent::kStartSending:
+    case LogEvent::kFinishSending:
+    case LogEvent::kMaxRetriesExceeded:
+    case LogEvent::kStartReceiving:
+    case LogEvent::kReceived:
+    case LogEvent::kMissed:
+      RenderStation(record.station_id, text);
+      if (record.src_id == LogRecord::kUnknownId) {
+        text += ":\t!!! corrupted frame,\tmissed message = \"";
+        text += GetEventMessage(record.event);
+        text += "\"";
+        break;
+      }
+      text += ":\t";
+      text += GetEventMessage(record.event);
+      text += ",\tsource = ";
+      RenderStation(record.src_id, text);
+      text += ",\tdestination = ";
+      RenderStation(record.dst_id, text);
+      text += ",\tdata = \"";
+      // Generated payload is not stored, its data depends only on length.
+      // Loaded text is indexed before generated ids appear, and renderer runs
+      // in writer thread, so it does not index text itself
+      text += payload_.IsIndexed(record.payload_id)
+                  ? payload_.Get(record.payload_id).data
+                  : GetGeneratedData(record.value);
+      text += "\"";
+      break;
+    case LogEvent::kRetry:
+      RenderStation(record.station_id, text);
+      text += ":\t";
+      text += GetEventMessage(record.event);
+      text += std::to_string(record.value);
+      break;
+    default:
+      RenderStation(record.station_id, text);
+      text += ":\t";
+      text += GetEventMessage(record.event);
+  }
+  text += '\n';
 }
 
-void Logger::LogClock() {
+void LogRenderer::RenderClock(uint64_t tick, std::string& text) const {
+  const auto clock = kProcessStart + tick * kTickDuration;
   const std::chrono::hours hours =
-      std::chrono::floor<std::chrono::hours>(clock_);
+      std::chrono::floor<std::chrono::hours>(clock);
   const std::chrono::minutes minutes =
-      std::chrono::floor<std::chrono::minutes>(clock_) - hours;
+      std::chrono::floor<std::chrono::minutes>(clock) - hours;
   const std::chrono::seconds seconds =
-      std::chrono::floor<std::chrono::seconds>(clock_) - hours - minutes;
+      std::chrono::floor<std::chrono::seconds>(clock) - hours - minutes;
   const std::chrono::milliseconds millis =
-      std::chrono::floor<std::chrono::milliseconds>(clock_) - hours - minutes -
+      std::chrono::floor<std::chrono::milliseconds>(clock) - hours - minutes -
       seconds;
   const std::chrono::microseconds micros =
-      std::chrono::floor<std::chrono::microseconds>(clock_) - hours - minutes -
+      std::chrono::floor<std::chrono::microseconds>(clock) - hours - minutes -
       seconds - millis;
-  log_stream_ << std::setfill('0') << std::setw(2) << hours.count() << ":"
-              << std::setw(2) << minutes.count() << ":" << std::setw(2)
-              << seconds.count() << "." << std::setw(3) << millis.count()
-              << std::setw(3) << micros.count() << ":\t";
+  AppendPadded(hours.count(), 2, '0', text);
+  text += ':';
+  AppendPadded(minutes.count(), 2, '0', text);
+  text += ':';
+  AppendPadded(seconds.count(), 2, '0', text);
+  text += '.';
+  AppendPadded(millis.count(), 3, '0', text);
+  AppendPadded(micros.count(), 3, '0', text);
+  text += ":\t";
 }
 
-void Logger::LogStation(size_t id) {
-  if (id >= kMaxStationsCount) {
-    log_stream_ << "all stations";
+void LogRenderer::RenderStation(size_t id, std::string& text) const {
+  if (id == kBroadcastId) {
+    text += "all stations";
   } else {
-    log_stream_ << "station " << std::setfill(' ') << std::setw(id_width_)
-                << id;
+    text += "station ";
+    AppendPadded(id, id_width_, ' ', text);
   }
 }
 
@@ -1,32 +1,88 @@
 #pragma once
 
+#include <chrono>
+#include <cstdint>
 #include <ostream>
+#include <string>
+#include <vector>
 
 namespace csma_cd {
 
-class Payload;
-class Frame;
+struct Payload;
+class PayloadSource;
+struct BusFrame;
 
+enum class LogEvent : uint8_t {
+  // Station events about payload or frame
+  kStartSending,
+  kFinishSending,
+  kMaxRetriesExceeded,
+  kStartReceiving,
+  kReceived,
+  kMissed,
+  // Other station events
+  kRetry,
+  kNothingToSend,
+  kReceiveInterrupt,
+  kCorruptedFrame,
+  // Bus events
+  kCollision,
+};
+
+// Fixed-size log entry, rendered to text only when log is written
+struct LogRecord {
+  // Marks id which could not be decoded from frame
+  static constexpr uint32_t kUnknownId = UINT32_MAX;
+
+  uint64_t tick;
+  uint32_t station_id;
+  uint32_t src_id;
+  uint32_t dst_id;
+  uint32_t payload_id;
+  // Retry count, collision rate or length of frame data
+  uint32_t value;
+  LogEvent event;
+  uint8_t reserved[3];
+};
+
+static_assert(sizeof(LogRecord) == 32, "Binary log layout changed");
+
+// Appends records about simulation events to buffer
 class Logger {
  public:
-  Logger(std::ostream& log_stream, const std::chrono::nanoseconds& clock,
-         size_t max_id);
+  Logger(const std::chrono::nanoseconds& clock, std::vector<LogRecord>& records);
+  // Logger with the same clock appending to another buffer
+  Logger(const Logger& other, std::vector<LogRecord>& records);
 
-  void LogPayload(const csma_cd::Payload& payload, size_t station_id,
-                  const std::string& message);
-  void LogFrame(const csma_cd::Frame& frame, size_t station_id,
-                const std::string& message);
-  void LogMessage(size_t station_id, const std::string& message);
-  void LogBusMessage(const std::string& message);
+  void LogPayload(const csma_cd::Payload& payload, size_t payload_id,
+                  size_t station_id, LogEvent event);
+  void LogFrame(const csma_cd::BusFrame& bus_frame, size_t station_id,
+                LogEvent event);
+  void LogMessage(size_t station_id, LogEvent event, size_t value = 0);
+  void LogBusMessage(LogEvent event, size_t value);
 
  private:
-  void LogClock();
-  void LogStation(size_t id);
+  uint64_t GetTick() const;
 
  private:
-  std::ostream& log_stream_;
   const std::chrono::nanoseconds& clock_;
+  std::vector<LogRecord>& records_;
+};
+
+// Renders records as text lines
+class LogRenderer {
+ public:
+  LogRenderer(size_t stations_count, const PayloadSource& payload);
+
+  void Render(const LogRecord& record, std::string& text) const;
+
+ private:
+  void RenderClock(uint64_t tick, std::string& text) const;
+  void RenderStation(size_t id, std::string& text) const;
+
+ private:
   size_t id_width_;
+  const PayloadSource& payload_;
 };
 
 }  // namespace csma_cd
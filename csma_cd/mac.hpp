@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include "consts.hpp"
+
+namespace csma_cd {
+
+enum class Backoff {
+  kExponential,  // window doubles on every retry up to limit
+  kLinear,       // window grows by one slot on every retry up to limit
+};
+
+enum class Persistence {
+  kNonPersistent,  // station backs off when bus is busy
+  kOnePersistent,  // station waits for free bus and sends at once
+  kPPersistent,    // station waits for free bus and sends with probability p
+};
+
+struct MacConfig {
+  Backoff backoff = Backoff::kExponential;
+  Persistence persistence = Persistence::kNonPersistent;
+  // Count of retries after which backoff window stops growing
+  size_t backoff_limit = kMaxSleepIncrease;
+  // Frame is dropped after this count of retries
+  size_t max_retries = kMaxRetries;
+  // Length of backoff slot in ticks
+  size_t slot_ticks = 1;
+  // Probability of sending on free bus for p-persistent stations
+  double send_probability = 1;
+};
+
+// Integer parameters of MAC shared by all stations
+struct MacParams {
+  explicit MacParams(const MacConfig& config)
+      : backoff_limit(config.backoff_limit),
+        max_retries(config.max_retries),
+        slot_ticks(config.slot_ticks),
+        send_threshold(config.send_probability * (uint64_t{1} << 32u)) {
+    if (!config.slot_ticks) {
+      throw std::invalid_argument("Backoff slot must be at least one tick");
+    }
+    if (config.backoff == Backoff::kExponential && config.backoff_limit > 31) {
+      throw std::invalid_argument("Backoff limit must be at most 31");
+    }
+    // Sleep timers of stations are 32-bit, so longest backoff must fit them
+    const uint64_t max_delay = config.backoff == Backoff::kExponential
+                                   ? uint64_t{1} << config.backoff_limit
+                                   : uint64_t{config.backoff_limit} + 1;
+    if (config.backoff_limit >= UINT32_MAX || config.slot_ticks > UINT32_MAX ||
+        max_delay > UINT32_MAX / config.slot_ticks) {
+      throw std::invalid_argument(
+          "Longest backoff must be at most " + std::to_string(UINT32_MAX) +
+          " ticks");
+    }
+    // Retry counter of station must not wrap past max retries
+    if (config.max_retries >= UINT32_MAX) {
+      throw std::invalid_argument("Max retries must be less than " +
+                                  std::to_string(UINT32_MAX));
+    }
+    if (config.send_probability <= 0 || config.send_probability > 1) {
+      throw std::invalid_argument("Send probability must be in (0, 1]");
+    }
+  }
+
+  uint32_t backoff_limit;
+  uint32_t max_retries;
+  uint32_t slot_ticks;
+  // Station sends if upper half of random number is below threshold
+  uint64_t send_threshold;
+};
+
+// Access method known at compile time, so station logic has no checks of
+// config on every tick
+template <Backoff kBackoffValue, Persistence kPersistenceValue>
+struct MacPolicy {
+  static constexpr Backoff kBackoff = kBackoffValue;
+  static constexpr Persistence kPersistence = kPersistenceValue;
+
+  // Upper bound of backoff delay in slots after given count of retries
+  static uint32_t GetMaxDelay(uint32_t retry_count, uint32_t limit) {
+    const uint32_t steps = retry_count < limit ? retry_count : limit;
+    if constexpr (kBackoff == Backoff::kExponential) {
+      return uint32_t{1} << steps;
+    } else {
+      return steps + 1;
+    }
+  }
+};
+
+// Calls function with policy object matching config, so the whole run uses
+// one specialization
+template <typename Function>
+decltype(auto) DispatchMacPolicy(const MacConfig& config, Function function) {
+  const auto dispatch_persistence = [&](auto backoff) -> decltype(auto) {
+    constexpr Backoff kBackoff = decltype(backoff)::value;
+    switch (config.persistence) {
+      case Persistence::kOnePersistent:
+        return function(MacPolicy<kBackoff, Persistence::kOnePersistent>());
+      case Persistence::kPPersistent:
+        return function(MacPolicy<kBackoff, Persistence::kPPersistent>());
+      default:
+        return function(MacPolicy<kBackoff, Persistence::kNonPersistent>());
+    }
+  };
+  if (config.backoff == Backoff::kLinear) {
+    return dispatch_persistence(
+        std::integral_constant<Backoff, Backoff::kLinear>());
+  }
+  return dispatch_persistence(
+      std::integral_constant<Backoff, Backoff::kExponential>());
+}
+
+}  // namespace csma_cd
@@ -1,78 +1,449 @@
+#include <csignal>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
+#include <random>
+#include <system_error>
 #include <thread>
 
 #include "ethernet.hpp"
+#include "network.hpp"
+#include "pacer.hpp"
+#include "payload_file.hpp"
+#include "profiler.hpp"
+#include "sweep.hpp"
 
 struct Args {
   size_t stations_count{};
   std::string payload_file_path{};
   std::optional<std::chrono::milliseconds> tick_delay{};
+  std::optional<double> realtime_speed{};
+  csma_cd::EthernetConfig ethernet_config{};
+  std::optional<std::string> render_log_path{};
+  std::optional<std::string> trace_path{};
+  std::optional<std::string> metrics_path{};
+  csma_cd::MetricsFormat metrics_format{};
+  size_t metrics_interval{};
+  std::optional<csma_cd::SweepConfig> sweep_config{};
+  std::optional<std::string> checkpoint_path{};
+  size_t checkpoint_interval{};
+  std::optional<std::string> restore_path{};
+  std::optional<std::string> topology_path{};
+  std::optional<std::string> capture_path{};
+  size_t snaplen{};
+  std::optional<std::string> profile_path{};
+  size_t profile_interval{};
+  std::optional<std::string> profile_trace_path{};
+  size_t profile_sample{};
 };
 
+// Set by SIGUSR1, checkpoint is written after current tick
+volatile std::sig_atomic_t is_checkpoint_requested = 0;
+
+void RequestCheckpoint(int) { is_checkpoint_requested = 1; }
+
+// Splits comma separated list of numbers
+template <typename T>
+std::vector<T> ParseList(const std::string& list) {
+  std::vector<T> values;
+  size_t begin = 0;
+  while (begin <= list.size()) {
+    const size_t end = std::min(list.find(',', begin), list.size());
+    const std::string value = list.substr(begin, end - begin);
+    if constexpr (std::is_floating_point_v<T>) {
+      values.push_back(std::stod(value));
+    } else {
+      values.push_back(std::stoul(value));
+    }
+    begin = end + 1;
+  }
+  return values;
+}
+
 Args ParseArgs(int argc, char** argv) {
-  if (argc < 5) {
+  if (argc < 3) {
     throw std::invalid_argument("");
   }
 
-  std::optional<size_t> stations_count;
+  // Lists are allowed only in sweep
+  std::vector<size_t> stations_counts;
+  std::vector<double> offered_loads;
   std::optional<std::string> payload_file_path;
   std::optional<std::chrono::milliseconds> tick_delay;
+  std::optional<double> realtime_speed;
+  csma_cd::EthernetConfig ethernet_config;
+  std::optional<std::string> render_log_path;
+  std::optional<std::string> trace_path;
+  std::optional<std::string> metrics_path;
+  auto metrics_format = csma_cd::MetricsFormat::kJson;
+  size_t metrics_interval = 0;
+  std::optional<size_t> threads_count;
+  std::optional<size_t> replications;
+  std::optional<std::string> checkpoint_path;
+  size_t checkpoint_interval = 0;
+  std::optional<std::string> restore_path;
+  std::optional<std::string> topology_path;
+  std::optional<std::string> capture_path;
+  size_t snaplen = 0;
+  std::optional<std::string> profile_path;
+  size_t profile_interval = 0;
+  std::optional<std::string> profile_trace_path;
+  size_t profile_sample = 1000;
   for (int i = 1; i < argc; i += 2) {
     if (std::string(argv[i]) == "-N") {
-      stations_count = std::stoul(argv[i + 1]);
+      stations_counts = ParseList<size_t>(argv[i + 1]);
     } else if (std::string(argv[i]) == "-f") {
       payload_file_path = argv[i + 1];
     } else if (std::string(argv[i]) == "-s") {
       tick_delay = std::chrono::milliseconds(std::stoul(argv[i + 1]));
+    } else if (std::string(argv[i]) == "--realtime") {
+      realtime_speed = std::stod(argv[i + 1]);
+    } else if (std::string(argv[i]) == "-m") {
+      if (std::string(argv[i + 1]) == "tick") {
+        ethernet_config.engine_mode = csma_cd::EngineMode::kTick;
+      } else if (std::string(argv[i + 1]) == "event") {
+        ethernet_config.engine_mode = csma_cd::EngineMode::kEvent;
+      } else {
+        throw std::invalid_argument("");
+      }
+    } else if (std::string(argv[i]) == "-c") {
+      if (std::string(argv[i + 1]) == "bus") {
+        ethernet_config.paranoid_crc = false;
+      } else if (std::string(argv[i + 1]) == "station") {
+        ethernet_config.paranoid_crc = true;
+      } else {
+        throw std::invalid_argument("");
+      }
+    } else if (std::string(argv[i]) == "-e") {
+      ethernet_config.frame_error_rate = std::stod(argv[i + 1]);
+    } else if (std::string(argv[i]) == "-j") {
+      threads_count = std::stoul(argv[i + 1]);
+      ethernet_config.threads_count = *threads_count;
+    } else if (std::string(argv[i]) == "-l") {
+      if (std::string(argv[i + 1]) == "text") {
+        ethernet_config.log_format = csma_cd::LogFormat::kText;
+      } else if (std::string(argv[i + 1]) == "binary") {
+        ethernet_config.log_format = csma_cd::LogFormat::kBinary;
+      } else if (std::string(argv[i + 1]) == "none") {
+        ethernet_config.log_format = csma_cd::LogFormat::kNone;
+      } else {
+        throw std::invalid_argument("");
+      }
+    } else if (std::string(argv[i]) == "-r") {
+      render_log_path = argv[i + 1];
+    } else if (std::string(argv[i]) == "-t") {
+      trace_path = argv[i + 1];
+    } else if (std::string(argv[i]) == "--metrics") {
+      metrics_path = argv[i + 1];
+      ethernet_config.collect_metrics = true;
+    } else if (std::string(argv[i]) == "--metrics-format") {
+      if (std::string(argv[i + 1]) == "json") {
+        metrics_format = csma_cd::MetricsFormat::kJson;
+      } else if (std::string(argv[i + 1]) == "csv") {
+        metrics_format = csma_cd::MetricsFormat::kCsv;
+      } else {
+        throw std::invalid_argument("");
+      }
+    } else if (std::string(argv[i]) == "--metrics-interval") {
+      metrics_interval = std::stoul(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--traffic") {
+      auto& pattern = ethernet_config.traffic.pattern;
+      if (std::string(argv[i + 1]) == "poisson") {
+        pattern = csma_cd::TrafficPattern::kPoisson;
+      } else if (std::string(argv[i + 1]) == "onoff") {
+        pattern = csma_cd::TrafficPattern::kOnOff;
+      } else if (std::string(argv[i + 1]) == "cbr") {
+        pattern = csma_cd::TrafficPattern::kConstant;
+      } else {
+        throw std::invalid_argument("");
+      }
+    } else if (std::string(argv[i]) == "--load") {
+      offered_loads = ParseList<double>(argv[i + 1]);
+      ethernet_config.traffic.offered_load = offered_loads.front();
+    } else if (std::string(argv[i]) == "--duration") {
+      ethernet_config.traffic.duration = std::stoull(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--burst") {
+      ethernet_config.traffic.mean_burst = std::stod(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--data-length") {
+      ethernet_config.traffic.data_length = std::stoul(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--seed") {
+      ethernet_config.seed = std::stoull(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--sweep") {
+      replications = std::stoul(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--checkpoint") {
+      checkpoint_path = argv[i + 1];
+    } else if (std::string(argv[i]) == "--checkpoint-interval") {
+      checkpoint_interval = std::stoul(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--restore") {
+      restore_path = argv[i + 1];
+    } else if (std::string(argv[i]) == "--topology") {
+      topology_path = argv[i + 1];
+    } else if (std::string(argv[i]) == "--backoff") {
+      if (std::string(argv[i + 1]) == "exponential") {
+        ethernet_config.mac.backoff = csma_cd::Backoff::kExponential;
+      } else if (std::string(argv[i + 1]) == "linear") {
+        ethernet_config.mac.backoff = csma_cd::Backoff::kLinear;
+      } else {
+        throw std::invalid_argument("");
+      }
+    } else if (std::string(argv[i]) == "--backoff-limit") {
+      ethernet_config.mac.backoff_limit = std::stoul(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--max-retries") {
+      ethernet_config.mac.max_retries = std::stoul(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--slot") {
+      ethernet_config.mac.slot_ticks = std::stoul(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--persistence") {
+      auto& persistence = ethernet_config.mac.persistence;
+      if (std::string(argv[i + 1]) == "non") {
+        persistence = csma_cd::Persistence::kNonPersistent;
+      } else if (std::string(argv[i + 1]) == "1") {
+        persistence = csma_cd::Persistence::kOnePersistent;
+      } else if (std::string(argv[i + 1]) == "p") {
+        persistence = csma_cd::Persistence::kPPersistent;
+      } else {
+        throw std::invalid_argument("");
+      }
+    } else if (std::string(argv[i]) == "--send-probability") {
+      ethernet_config.mac.send_probability = std::stod(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--capture") {
+      capture_path = argv[i + 1];
+    } else if (std::string(argv[i]) == "--snaplen") {
+      snaplen = std::stoul(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--profile") {
+      profile_path = argv[i + 1];
+    } else if (std::string(argv[i]) == "--profile-interval") {
+      profile_interval = std::stoul(argv[i + 1]);
+    } else if (std::string(argv[i]) == "--profile-trace") {
+      profile_trace_path = argv[i + 1];
+    } else if (std::string(argv[i]) == "--profile-sample") {
+      profile_sample = std::stoul(argv[i + 1]);
     } else {
       throw std::invalid_argument("");
     }
   }
 
-  if (!stations_count || !payload_file_path) {
+  // Simulation needs payload file or generated traffic, rendering binary log
+  // needs only payload the log was written for, conversion needs only payload
+  const bool has_traffic = ethernet_config.traffic.offered_load > 0;
+  if (replications) {
+    // Sweep runs only generated traffic, -j sets concurrent simulations
+    if (stations_counts.empty() || !has_traffic || payload_file_path ||
+        render_log_path || trace_path || capture_path || realtime_speed ||
+        profile_path || profile_trace_path) {
+      throw std::invalid_argument("");
+    }
+    csma_cd::SweepConfig sweep_config;
+    sweep_config.stations_counts = stations_counts;
+    sweep_config.offered_loads = offered_loads;
+    sweep_config.replications = *replications;
+    sweep_config.seed = ethernet_config.seed.value_or(std::random_device()());
+    sweep_config.threads_count =
+        threads_count.value_or(std::thread::hardware_concurrency());
+    sweep_config.ethernet_config = ethernet_config;
+    Args args;
+    args.sweep_config = sweep_config;
+    return args;
+  }
+  if (stations_counts.size() > 1 || offered_loads.size() > 1 ||
+      (tick_delay && realtime_speed)) {
     throw std::invalid_argument("");
   }
-  return {*stations_count, *payload_file_path, tick_delay};
+  // Topology sets stations itself and runs only payload file, -j sets
+  // concurrent segments
+  if (topology_path) {
+    if (!stations_counts.empty() || !payload_file_path || has_traffic ||
+        render_log_path || trace_path || checkpoint_path || restore_path ||
+        capture_path || realtime_speed || profile_path || profile_trace_path) {
+      throw std::invalid_argument("");
+    }
+    Args args;
+    args.payload_file_path = *payload_file_path;
+    args.tick_delay = tick_delay;
+    args.ethernet_config = ethernet_config;
+    args.metrics_path = metrics_path;
+    args.metrics_format = metrics_format;
+    args.metrics_interval = metrics_interval;
+    args.topology_path = topology_path;
+    return args;
+  }
+  const size_t stations_count =
+      stations_counts.empty() ? 0 : stations_counts.front();
+  if (!render_log_path && !(trace_path && payload_file_path) &&
+      !(stations_count && (payload_file_path || has_traffic))) {
+    throw std::invalid_argument("");
+  }
+  return {stations_count, payload_file_path.value_or(""),
+          tick_delay, realtime_speed,
+          ethernet_config, render_log_path, trace_path, metrics_path,
+          metrics_format, metrics_interval, std::nullopt, checkpoint_path,
+          checkpoint_interval, restore_path, std::nullopt, capture_path,
+          snaplen, profile_path, profile_interval, profile_trace_path,
+          profile_sample};
 }
 
-std::vector<csma_cd::Payload> LoadPayloadFromFile(
-    const std::string& payload_file_path) {
-  std::ifstream payload_file(payload_file_path);
-  std::vector<csma_cd::Payload> payload;
-
-  while (!payload_file.eof()) {
-    std::string src_id;
-    std::string dst_id;
-    payload_file >> src_id >> dst_id;
-    if (payload_file.eof()) {
-      break;
-    }
-
-    std::string data(1600, 0);
-    payload_file.getline(data.data(), data.size());
-    data.erase(data.begin(), std::find_if(data.begin(), data.end(), [](char c) {
-                 return !std::isspace(c);
-               }));
-    data = data.data();
-    if (data.size() > 1500) {
-      throw std::invalid_argument(
-          "Bad payload: data length must be less than 1500");
+// Checks if tick reached next multiple of interval, skipped ticks may pass
+// several intervals at once
+bool IsIntervalPassed(size_t tick, size_t interval, size_t& next_tick) {
+  if (!interval || tick < next_tick) {
+    return false;
+  }
+  next_tick = (tick / interval + 1) * interval;
+  return true;
+}
+
+// Replaces checkpoint at once, so it stays valid if process is killed while
+// writing
+void WriteCheckpoint(const csma_cd::Ethernet& ethernet,
+                     const std::string& path) {
+  const std::string temp_path = path + ".tmp";
+  std::ofstream checkpoint(temp_path, std::ios::binary);
+  ethernet.SaveCheckpoint(checkpoint);
+  checkpoint.close();
+  if (!checkpoint || std::rename(temp_path.c_str(), path.c_str())) {
+    throw std::invalid_argument("Cannot write checkpoint " + path);
+  }
+}
+
+void ProcessPayload(csma_cd::Ethernet& ethernet, const Args& args) {
+  std::ofstream metrics_file;
+  if (args.metrics_path) {
+    metrics_file.open(*args.metrics_path);
+    if (!metrics_file) {
+      throw std::invalid_argument("Cannot open metrics file " +
+                                  *args.metrics_path);
+    }
+    if (args.metrics_format == csma_cd::MetricsFormat::kCsv) {
+      csma_cd::Metrics::WriteCsvHeader(metrics_file,
+                                       args.ethernet_config.mac.max_retries);
     }
+  }
+  if (args.checkpoint_path) {
+    std::signal(SIGUSR1, RequestCheckpoint);
+  }
+  std::ofstream profile_file;
+  if (args.profile_path) {
+    profile_file.open(*args.profile_path);
+    if (!profile_file) {
+      throw std::invalid_argument("Cannot open profile file " +
+                                  *args.profile_path);
+    }
+  }
+  // Trace is written at exit, file is opened early to fail before run
+  std::ofstream profile_trace_file;
+  if (args.profile_trace_path) {
+    profile_trace_file.open(*args.profile_trace_path);
+    if (!profile_trace_file) {
+      throw std::invalid_argument("Cannot open profile trace " +
+                                  *args.profile_trace_path);
+    }
+    csma_cd::profiler::EnableTrace(args.profile_sample);
+  }
 
-    payload.push_back({std::stoul(src_id), std::stoul(dst_id), data});
+  // Ticks are processed one by one not earlier than their deadlines, idle
+  // ticks are waited through at once
+  std::optional<csma_cd::Pacer> pacer;
+  if (args.realtime_speed) {
+    pacer.emplace(ethernet.GetTick(), *args.realtime_speed);
   }
 
-  return payload;
+  // Simulation may be restored at any tick
+  size_t next_report_tick = 0;
+  size_t next_checkpoint_tick = 0;
+  IsIntervalPassed(ethernet.GetTick(), args.metrics_interval,
+                   next_report_tick);
+  IsIntervalPassed(ethernet.GetTick(), args.checkpoint_interval,
+                   next_checkpoint_tick);
+  size_t next_profile_tick = 0;
+  IsIntervalPassed(ethernet.GetTick(), args.profile_interval,
+                   next_profile_tick);
+  while (!ethernet.IsIdle()) {
+    std::optional<size_t> max_ticks;
+    if (pacer) {
+      const size_t next_tick =
+          ethernet.GetNextEventTick().value_or(ethernet.GetTick());
+      pacer->WaitForTick(next_tick);
+      max_ticks = next_tick - ethernet.GetTick() + 1;
+    }
+    const size_t ticks = ethernet.ProcessEvent(max_ticks);
+    if (args.tick_delay) {
+      std::this_thread::sleep_for(*args.tick_delay * ticks);
+    }
+    if (args.metrics_path &&
+        IsIntervalPassed(ethernet.GetTick(), args.metrics_interval,
+                         next_report_tick)) {
+      ethernet.GetMetrics()->WriteSnapshot(metrics_file, args.metrics_format);
+    }
+    if (args.profile_path &&
+        IsIntervalPassed(ethernet.GetTick(), args.profile_interval,
+                         next_profile_tick)) {
+      csma_cd::profiler::WriteSummary(profile_file, ethernet.GetTick());
+    }
+    if (args.checkpoint_path &&
+        (IsIntervalPassed(ethernet.GetTick(), args.checkpoint_interval,
+                          next_checkpoint_tick) ||
+         is_checkpoint_requested)) {
+      is_checkpoint_requested = 0;
+      WriteCheckpoint(ethernet, *args.checkpoint_path);
+    }
+  }
+
+  if (args.metrics_path) {
+    ethernet.GetMetrics()->WriteSnapshot(metrics_file, args.metrics_format);
+  }
+  if (pacer) {
+    pacer->WriteReport(std::cerr);
+  }
+  if (args.profile_path) {
+    csma_cd::profiler::WriteSummary(profile_file, ethernet.GetTick());
+  }
+  if (args.profile_trace_path) {
+    csma_cd::profiler::WriteTrace(profile_trace_file);
+    profile_trace_file.close();
+    if (!profile_trace_file) {
+      throw std::invalid_argument("Cannot write profile trace " +
+                                  *args.profile_trace_path);
+    }
+  }
 }
 
-void ProcessPayload(csma_cd::Ethernet& ethernet,
-                    std::optional<std::chrono::milliseconds> tick_delay) {
-  while (!ethernet.IsIdle()) {
-    ethernet.ProcessTick();
-    if (tick_delay) {
-      std::this_thread::sleep_for(*tick_delay);
+// Metrics are written for every segment as they are separate channels
+void WriteNetworkMetrics(const csma_cd::Network& network, const Args& args,
+                         std::ostream& stream) {
+  for (size_t i = 0; i < network.GetSegmentsCount(); ++i) {
+    network.GetMetrics(i)->WriteSnapshot(stream, args.metrics_format);
+  }
+}
+
+void ProcessNetwork(csma_cd::Network& network, const Args& args) {
+  std::ofstream metrics_file;
+  if (args.metrics_path) {
+    metrics_file.open(*args.metrics_path);
+    if (!metrics_file) {
+      throw std::invalid_argument("Cannot open metrics file " +
+                                  *args.metrics_path);
+    }
+    if (args.metrics_format == csma_cd::MetricsFormat::kCsv) {
+      csma_cd::Metrics::WriteCsvHeader(metrics_file,
+                                       args.ethernet_config.mac.max_retries);
+    }
+  }
+
+  size_t next_report_tick = 0;
+  IsIntervalPassed(network.GetTick(), args.metrics_interval, next_report_tick);
+  while (!network.IsIdle()) {
+    const size_t ticks = network.ProcessRound();
+    if (args.tick_delay) {
+      std::this_thread::sleep_for(*args.tick_delay * ticks);
     }
+    if (args.metrics_path &&
+        IsIntervalPassed(network.GetTick(), args.metrics_interval,
+                         next_report_tick)) {
+      WriteNetworkMetrics(network, args, metrics_file);
+    }
+  }
+
+  if (args.metrics_path) {
+    WriteNetworkMetrics(network, args, metrics_file);
   }
 }
 
@@ -82,19 +453,134 @@ int main(int argc, char** argv) {
     args = ParseArgs(argc, argv);
   } catch (std::invalid_argument&) {
     std::cerr << "Usage:\t" << argv[0] << " -N <stations count> "
+              << "[-f <path to file with payload>] "
+              << "[-s <tick delay in ms>] "
+              << "[--realtime <speed relative to wall clock>] "
+              << "[-m <engine mode: tick | event>] "
+              << "[-c <crc check: bus | station>] "
+              << "[-e <frame error rate>] "
+              << "[-j <threads count>] "
+              << "[-l <log format: text | binary | none>] "
+              << "[--metrics <path to metrics file>] "
+              << "[--metrics-format <json | csv>] "
+              << "[--metrics-interval <ticks>] "
+              << "[--traffic <poisson | onoff | cbr>] "
+              << "[--load <offered load>] "
+              << "[--duration <traffic duration in ticks>] "
+              << "[--burst <mean on/off period in ticks>] "
+              << "[--data-length <generated data length>] "
+              << "[--seed <random seed>] "
+              << "[--backoff <exponential | linear>] "
+              << "[--backoff-limit <retries>] "
+              << "[--max-retries <retries>] "
+              << "[--slot <backoff slot in ticks>] "
+              << "[--persistence <non | 1 | p>] "
+              << "[--send-probability <p>] "
+              << "[--checkpoint <path to checkpoint written on SIGUSR1>] "
+              << "[--checkpoint-interval <ticks>] "
+              << "[--restore <path to checkpoint>] "
+              << "[--capture <path to pcapng capture>] "
+              << "[--snaplen <max captured bytes of frame>] "
+              << "[--profile <path to phase timings>] "
+              << "[--profile-interval <ticks>] "
+              << "[--profile-trace <path to Chrome trace>] "
+              << "[--profile-sample <traced tick period>]\n"
+              << "\t" << argv[0] << " -N <stations counts, comma separated> "
+              << "--traffic <poisson | onoff | cbr> "
+              << "--load <offered loads, comma separated> "
+              << "--duration <traffic duration in ticks> "
+              << "--sweep <replications count> "
+              << "[-m <engine mode: tick | event>] "
+              << "[-j <concurrent simulations count>] "
+              << "[--seed <base random seed>]\n"
+              << "\t" << argv[0] << " --topology <path to topology file> "
               << "-f <path to file with payload> "
-              << "[-s <tick delay in ms>]" << std::endl;
+              << "[-j <concurrent segments count>] "
+              << "[other options of simulation without traffic and "
+              << "checkpoints]\n"
+              << "\t" << argv[0] << " [-f <path to file with payload>] "
+              << "-r <path to binary log>\n"
+              << "\t" << argv[0] << " -f <path to file with payload> "
+              << "-t <path to binary trace>" << std::endl;
     return 1;
   }
 
   try {
-    csma_cd::Ethernet ethernet(args.stations_count,
-                               LoadPayloadFromFile(args.payload_file_path),
-                               std::cout);
-    ProcessPayload(ethernet, args.tick_delay);
+    if (args.sweep_config) {
+      csma_cd::RunSweep(*args.sweep_config, std::cout);
+      return 0;
+    }
+
+    // Payload data points into file, so it must outlive simulation
+    std::optional<csma_cd::PayloadFile> payload_file;
+    csma_cd::PayloadSource payload;
+    if (!args.payload_file_path.empty()) {
+      payload_file.emplace(args.payload_file_path);
+      payload = payload_file->Parse();
+    }
+    if (args.render_log_path) {
+      std::ifstream binary_log(*args.render_log_path, std::ios::binary);
+      csma_cd::RenderBinaryLog(binary_log, payload, std::cout);
+      return 0;
+    }
+    if (args.trace_path) {
+      std::ofstream trace(*args.trace_path, std::ios::binary);
+      if (!trace) {
+        throw std::invalid_argument("Cannot open trace file " +
+                                    *args.trace_path);
+      }
+      csma_cd::WriteTrace(payload, trace);
+      trace.close();
+      if (!trace) {
+        throw std::invalid_argument("Cannot write trace file " +
+                                    *args.trace_path);
+      }
+      return 0;
+    }
+
+    if ((args.profile_path || args.profile_trace_path) &&
+        !csma_cd::profiler::kIsEnabled) {
+      throw std::invalid_argument(
+          "Profiling is disabled, build with -DCSMA_CD_PROFILE=ON");
+    }
+
+    if (args.topology_path) {
+      csma_cd::Network network(csma_cd::ParseTopology(*args.topology_path),
+                               std::move(payload), std::cout,
+                               args.ethernet_config);
+      ProcessNetwork(network, args);
+      return 0;
+    }
+
+    // Capture is written until ethernet is destroyed
+    std::ofstream capture;
+    if (args.capture_path) {
+      capture.open(*args.capture_path, std::ios::binary);
+      if (!capture) {
+        throw std::invalid_argument("Cannot open capture file " +
+                                    *args.capture_path);
+      }
+    }
+    csma_cd::Ethernet ethernet(args.stations_count, std::move(payload),
+                               std::cout, args.ethernet_config);
+    if (args.capture_path) {
+      ethernet.SetCapture(capture, args.snaplen);
+    }
+    if (args.restore_path) {
+      std::ifstream checkpoint(*args.restore_path, std::ios::binary);
+      if (!checkpoint) {
+        throw std::invalid_argument("Cannot open checkpoint " +
+                                    *args.restore_path);
+      }
+      ethernet.LoadCheckpoint(checkpoint);
+    }
+    ProcessPayload(ethernet, args);
   } catch (std::invalid_argument& exc) {
     std::cerr << exc.what() << std::endl;
     return 2;
+  } catch (std::system_error& exc) {
+    std::cerr << exc.what() << std::endl;
+    return 1;
   }
 
   return 0;
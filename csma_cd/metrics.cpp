@@ -0,0 +1,287 @@
+#include "metrics.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+#include "frame.hpp"
+
+namespace csma_cd {
+
+Histogram::Histogram()
+    : counts_(kSubBucketsCount * (64 - kSubBucketBits + 1)),
+      count_(0),
+      min_(std::numeric_limits<uint64_t>::max()),
+      max_(0),
+      sum_(0) {}
+
+void Histogram::Record(uint64_t value) {
+  ++counts_[GetBucket(value)];
+  ++count_;
+  min_ = std::min(min_, value);
+  max_ = std::max(max_, value);
+  sum_ += value;
+}
+
+uint64_t Histogram::GetCount() const { return count_; }
+
+uint64_t Histogram::GetMin() const { return count_ ? min_ : 0; }
+
+uint64_t Histogram::GetMax() const { return max_; }
+
+double Histogram::GetMean() const { return count_ ? sum_ / count_ : 0; }
+
+uint64_t Histogram::GetPercentile(double fraction) const {
+  const auto rank = std::max<uint64_t>(1, std::ceil(fraction * count_));
+  uint64_t seen = 0;
+  for (size_t bucket = 0; bucket < counts_.size(); ++bucket) {
+    seen += counts_[bucket];
+    if (seen >= rank) {
+      return std::min(GetBucketUpperBound(bucket), max_);
+    }
+  }
+  return max_;
+}
+
+void Histogram::Save(CheckpointWriter& writer) const {
+  writer.WriteArray(counts_.data(), counts_.size());
+  writer.Write(count_);
+  writer.Write(min_);
+  writer.Write(max_);
+  writer.Write(sum_);
+}
+
+void Histogram::Load(CheckpointReader& reader) {
+  reader.ReadArray(counts_.data(), counts_.size());
+  reader.Read(count_);
+  reader.Read(min_);
+  reader.Read(max_);
+  reader.Read(sum_);
+}
+
+size_t Histogram::GetBucket(uint64_t value) {
+  if (value < kSubBucketsCount) {
+    return value;
+  }
+  // Values with the same highest bit share range of kSubBucketsCount buckets
+  const size_t shift = 63 - __builtin_clzll(value) - kSubBucketBits;
+  return kSubBucketsCount * (shift + 1) + (value >> shift) - kSubBucketsCount;
+}
+
+uint64_t Histogram::GetBucketUpperBound(size_t bucket) {
+  if (bucket < kSubBucketsCount) {
+    return bucket;
+  }
+  const size_t shift = bucket / kSubBucketsCount - 1;
+  const uint64_t lower = (kSubBucketsCount + bucket % kSubBucketsCount)
+                         << shift;
+  return lower + (uint64_t{1} << shift) - 1;
+}
+
+Metrics::Metrics(size_t stations_count, size_t max_retries)
+    : ticks_(0),
+      arrivals_(0),
+      attempts_(0),
+      collided_attempts_(0),
+      collisions_(0),
+      sent_frames_(0),
+      dropped_frames_(0),
+      offered_ticks_(0),
+      sent_ticks_(0),
+      retries_(max_retries + 1),
+      queue_sizes_(stations_count),
+      head_since_(stations_count),
+      last_start_(stations_count),
+      retry_counts_(stations_count),
+      station_attempts_(stations_count),
+      station_sent_(stations_count) {}
+
+void Metrics::CollectArrival(size_t station_id, uint64_t tick,
+                             size_t data_length) {
+  ++arrivals_;
+  offered_ticks_ += GetFrameLengthInTicks(data_length);
+  if (queue_sizes_[station_id]++ == 0) {
+    head_since_[station_id] = tick;
+  }
+}
+
+void Metrics::Collect(const std::vector<LogRecord>& records, uint64_t ticks) {
+  ticks_ = ticks;
+  bool is_collision = false;
+  for (const auto& record : records) {
+    const size_t id = record.station_id;
+    switch (record.event) {
+      case LogEvent::kStartSending:
+        ++attempts_;
+        ++station_attempts_[id];
+        last_start_[id] = record.tick;
+        break;
+      case LogEvent::kFinishSending:
+        ++sent_frames_;
+        sent_ticks_ += GetFrameLengthInTicks(record.value);
+        ++station_sent_[id];
+        access_delay_.Record(last_start_[id] - head_since_[id]);
+        ++retries_[retry_counts_[id]];
+        retry_counts_[id] = 0;
+        // Next frame in queue can be sent in the same tick
+        if (--queue_sizes_[id]) {
+          head_since_[id] = record.tick;
+        }
+        break;
+      case LogEvent::kMaxRetriesExceeded:
+        ++collided_attempts_;
+        ++dropped_frames_;
+        retry_counts_[id] = 0;
+        if (--queue_sizes_[id]) {
+          head_since_[id] = record.tick;
+        }
+        break;
+      case LogEvent::kRetry:
+        ++collided_attempts_;
+        retry_counts_[id] = record.value;
+        break;
+      case LogEvent::kCollision:
+        is_collision = true;
+        break;
+      default:
+        break;
+    }
+  }
+  collisions_ += is_collision;
+}
+
+void Metrics::WriteSnapshot(std::ostream& stream, MetricsFormat format) const {
+  if (format == MetricsFormat::kJson) {
+    WriteJson(stream);
+  } else {
+    WriteCsv(stream);
+  }
+}
+
+void Metrics::WriteCsvHeader(std::ostream& stream, size_t max_retries) {
+  stream << "ticks,arrivals,offered_load,attempts,sent,dropped,collisions,"
+            "collision_rate,utilization,fairness,delay_mean,delay_p50,"
+            "delay_p90,delay_p99,delay_max";
+  for (size_t i = 0; i <= max_retries; ++i) {
+    stream << ",retries_" << i;
+  }
+  stream << '\n';
+}
+
+uint64_t Metrics::GetSentFrames() const { return sent_frames_; }
+
+uint64_t Metrics::GetDroppedFrames() const { return dropped_frames_; }
+
+double Metrics::GetOfferedLoad() const {
+  return ticks_ ? static_cast<double>(offered_ticks_) / ticks_ : 0;
+}
+
+double Metrics::GetChannelUtilization() const {
+  return ticks_ ? static_cast<double>(sent_ticks_) / ticks_ : 0;
+}
+
+double Metrics::GetCollisionRate() const {
+  return attempts_ ? static_cast<double>(collided_attempts_) / attempts_ : 0;
+}
+
+double Metrics::GetFairnessIndex() const {
+  double sum = 0;
+  double square_sum = 0;
+  size_t active_count = 0;
+  for (size_t id = 0; id < station_sent_.size(); ++id) {
+    if (station_attempts_[id]) {
+      sum += station_sent_[id];
+      square_sum += static_cast<double>(station_sent_[id]) * station_sent_[id];
+      ++active_count;
+    }
+  }
+  return square_sum > 0 ? sum * sum / (active_count * square_sum) : 0;
+}
+
+const Histogram& Metrics::GetAccessDelay() const { return access_delay_; }
+
+void Metrics::Save(CheckpointWriter& writer) const {
+  for (const uint64_t counter :
+       {ticks_, arrivals_, attempts_, collided_attempts_, collisions_,
+        sent_frames_, dropped_frames_, offered_ticks_, sent_ticks_}) {
+    writer.Write(counter);
+  }
+  access_delay_.Save(writer);
+  writer.Write(static_cast<uint64_t>(retries_.size()));
+  writer.WriteArray(retries_.data(), retries_.size());
+  writer.WriteArray(queue_sizes_.data(), queue_sizes_.size());
+  writer.WriteArray(head_since_.data(), head_since_.size());
+  writer.WriteArray(last_start_.data(), last_start_.size());
+  writer.WriteArray(retry_counts_.data(), retry_counts_.size());
+  writer.WriteArray(station_attempts_.data(), station_attempts_.size());
+  writer.WriteArray(station_sent_.data(), station_sent_.size());
+}
+
+void Metrics::Load(CheckpointReader& reader) {
+  for (uint64_t* counter :
+       {&ticks_, &arrivals_, &attempts_, &collided_attempts_, &collisions_,
+        &sent_frames_, &dropped_frames_, &offered_ticks_, &sent_ticks_}) {
+    reader.Read(*counter);
+  }
+  access_delay_.Load(reader);
+  uint64_t retries_size = 0;
+  reader.Read(retries_size);
+  if (retries_size != retries_.size()) {
+    throw std::invalid_argument("Bad checkpoint: max retries do not match");
+  }
+  reader.ReadArray(retries_.data(), retries_.size());
+  reader.ReadArray(queue_sizes_.data(), queue_sizes_.size());
+  reader.ReadArray(head_since_.data(), head_since_.size());
+  reader.ReadArray(last_start_.data(), last_start_.size());
+  reader.ReadArray(retry_counts_.data(), retry_counts_.size());
+  reader.ReadArray(station_attempts_.data(), station_attempts_.size());
+  reader.ReadArray(station_sent_.data(), station_sent_.size());
+  // Retry counts index histogram of retries
+  for (const uint32_t retry_count : retry_counts_) {
+    if (retry_count >= retries_.size()) {
+      throw std::invalid_argument("Bad checkpoint: retry count out of range");
+    }
+  }
+}
+
+void Metrics::WriteJson(std::ostream& stream) const {
+  stream << "{\"ticks\": " << ticks_ << ", \"arrivals\": " << arrivals_
+         << ", \"offered_load\": " << GetOfferedLoad()
+         << ", \"attempts\": " << attempts_
+         << ", \"sent\": " << sent_frames_
+         << ", \"dropped\": " << dropped_frames_
+         << ", \"collisions\": " << collisions_
+         << ", \"collision_rate\": " << GetCollisionRate()
+         << ", \"utilization\": " << GetChannelUtilization()
+         << ", \"fairness\": " << GetFairnessIndex()
+         << ", \"access_delay\": {\"count\": " << access_delay_.GetCount()
+         << ", \"min\": " << access_delay_.GetMin()
+         << ", \"mean\": " << access_delay_.GetMean()
+         << ", \"p50\": " << access_delay_.GetPercentile(0.5)
+         << ", \"p90\": " << access_delay_.GetPercentile(0.9)
+         << ", \"p99\": " << access_delay_.GetPercentile(0.99)
+         << ", \"max\": " << access_delay_.GetMax() << "}, \"retries\": [";
+  for (size_t i = 0; i < retries_.size(); ++i) {
+    stream << (i ? ", " : "") << retries_[i];
+  }
+  stream << "]}\n";
+}
+
+void Metrics::WriteCsv(std::ostream& stream) const {
+  stream << ticks_ << ',' << arrivals_ << ',' << GetOfferedLoad() << ','
+         << attempts_ << ',' << sent_frames_ << ',' << dropped_frames_ << ','
+         << collisions_ << ',' << GetCollisionRate() << ','
+         << GetChannelUtilization() << ',' << GetFairnessIndex() << ','
+         << access_delay_.GetMean() << ','
+         << access_delay_.GetPercentile(0.5) << ','
+         << access_delay_.GetPercentile(0.9) << ','
+         << access_delay_.GetPercentile(0.99) << ','
+         << access_delay_.GetMax();
+  for (const uint64_t retries : retries_) {
+    stream << ',' << retries;
+  }
+  stream << '\n';
+}
+
+}  // namespace csma_cd
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "logger.hpp"
+
+namespace csma_cd {
+
+enum class MetricsFormat {
+  kJson,  // one object per line
+  kCsv,   // header followed by one row per snapshot
+};
+
+// Histogram of non-negative values with bounded relative error: values are
+// split into power of two ranges, each range into equal sub-buckets
+class Histogram {
+ public:
+  Histogram();
+
+  void Record(uint64_t value);
+
+  uint64_t GetCount() const;
+  uint64_t GetMin() const;
+  uint64_t GetMax() const;
+  double GetMean() const;
+  // Upper bound of bucket holding given fraction of values
+  uint64_t GetPercentile(double fraction) const;
+
+  void Save(CheckpointWriter& writer) const;
+  void Load(CheckpointReader& reader);
+
+ private:
+  // 2^5 sub-buckets per range keep error within ~3%
+  static constexpr size_t kSubBucketBits = 5;
+  static constexpr size_t kSubBucketsCount = size_t{1} << kSubBucketBits;
+
+  static size_t GetBucket(uint64_t value);
+  static uint64_t GetBucketUpperBound(size_t bucket);
+
+ private:
+  std::vector<uint64_t> counts_;
+  uint64_t count_;
+  uint64_t min_;
+  uint64_t max_;
+  double sum_;
+};
+
+// Collects channel statistics from log records of processed ticks
+class Metrics {
+ public:
+  // Histogram of retries has entry for every count up to max retries
+  Metrics(size_t stations_count, size_t max_retries);
+
+  // Accounts payload queued by station on given tick
+  void CollectArrival(size_t station_id, uint64_t tick, size_t data_length);
+
+  // Accounts records of tick which ends at given count of passed ticks
+  void Collect(const std::vector<LogRecord>& records, uint64_t ticks);
+
+  // Writes cumulative statistics for all ticks collected so far
+  void WriteSnapshot(std::ostream& stream, MetricsFormat format) const;
+  // Columns of retries histogram depend on MAC config
+  static void WriteCsvHeader(std::ostream& stream, size_t max_retries);
+
+  uint64_t GetSentFrames() const;
+  uint64_t GetDroppedFrames() const;
+  // Fraction of ticks needed to send all arrived frames
+  double GetOfferedLoad() const;
+  // Fraction of ticks bus was carrying successfully sent frames
+  double GetChannelUtilization() const;
+  // Fraction of send attempts ended with collision
+  double GetCollisionRate() const;
+  // Jain's index over frames sent by stations which tried to send
+  double GetFairnessIndex() const;
+  const Histogram& GetAccessDelay() const;
+
+  void Save(CheckpointWriter& writer) const;
+  void Load(CheckpointReader& reader);
+
+ private:
+  void WriteJson(std::ostream& stream) const;
+  void WriteCsv(std::ostream& stream) const;
+
+ private:
+  uint64_t ticks_;
+  uint64_t arrivals_;
+  uint64_t attempts_;
+  uint64_t collided_attempts_;
+  uint64_t collisions_;
+  uint64_t sent_frames_;
+  uint64_t dropped_frames_;
+  // Ticks taken on bus by arrived and by successfully sent frames
+  uint64_t offered_ticks_;
+  uint64_t sent_ticks_;
+  // Ticks from frame reaching queue head to start of its successful sending
+  Histogram access_delay_;
+  // Retries made by successfully sent frames
+  std::vector<uint64_t> retries_;
+
+  // Per station state, indexed by station id
+  std::vector<uint32_t> queue_sizes_;
+  std::vector<uint64_t> head_since_;
+  std::vector<uint64_t> last_start_;
+  std::vector<uint32_t> retry_counts_;
+  std::vector<uint32_t> station_attempts_;
+  std::vector<uint32_t> station_sent_;
+};
+
+}  // namespace csma_cd
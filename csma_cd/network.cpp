@@ -0,0 +1,343 @@
+#include "network.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+namespace csma_cd {
+
+namespace {
+
+// Finds root of segment in forest of already connected segments
+size_t FindRoot(std::vector<size_t>& parents, size_t segment) {
+  while (parents[segment] != segment) {
+    parents[segment] = parents[parents[segment]];
+    segment = parents[segment];
+  }
+  return segment;
+}
+
+void ValidateTopology(const Topology& topology) {
+  if (topology.segment_sizes.empty()) {
+    throw std::invalid_argument("Bad topology: no segments");
+  }
+  if (!topology.latency) {
+    throw std::invalid_argument("Bad topology: latency must be positive");
+  }
+  std::vector<size_t> parents(topology.segment_sizes.size());
+  std::iota(parents.begin(), parents.end(), 0);
+  for (const auto& bridge : topology.bridges) {
+    if (bridge.size() < 2) {
+      throw std::invalid_argument(
+          "Bad topology: bridge must connect at least two segments");
+    }
+    for (const size_t segment : bridge) {
+      if (segment >= topology.segment_sizes.size()) {
+        throw std::invalid_argument("Bad topology: segment " +
+                                    std::to_string(segment) +
+                                    " does not exist");
+      }
+    }
+    // Frames would circulate forever around loop
+    const size_t root = FindRoot(parents, bridge.front());
+    for (size_t i = 1; i < bridge.size(); ++i) {
+      const size_t other_root = FindRoot(parents, bridge[i]);
+      if (other_root == root) {
+        throw std::invalid_argument("Bad topology: bridges form a loop");
+      }
+      parents[other_root] = root;
+    }
+  }
+}
+
+}  // namespace
+
+Topology ParseTopology(const std::string& path) {
+  std::ifstream file(path);
+  if (!file) {
+    throw std::invalid_argument("Cannot open topology file " + path);
+  }
+  Topology topology;
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream words(line);
+    std::string keyword;
+    if (!(words >> keyword) || keyword.front() == '#') {
+      continue;
+    }
+    if (keyword == "segment") {
+      size_t stations_count = 0;
+      if (!(words >> stations_count) || !stations_count) {
+        throw std::invalid_argument(
+            "Bad topology: segment must have stations count");
+      }
+      topology.segment_sizes.push_back(stations_count);
+    } else if (keyword == "bridge") {
+      auto& bridge = topology.bridges.emplace_back();
+      size_t segment = 0;
+      while (words >> segment) {
+        bridge.push_back(segment);
+      }
+    } else if (keyword == "latency") {
+      if (!(words >> topology.latency)) {
+        throw std::invalid_argument("Bad topology: latency must be a number");
+      }
+    } else {
+      throw std::invalid_argument("Bad topology: unknown line \"" + line +
+                                  "\"");
+    }
+    if (!words.eof()) {
+      throw std::invalid_argument(
+          "Bad topology: unexpected words in line \"" + line + "\"");
+    }
+  }
+  return topology;
+}
+
+Network::Network(const Topology& topology, PayloadSource payload,
+                 std::ostream& log_stream, const EthernetConfig& config)
+    : latency_(topology.latency), payload_(std::move(payload)) {
+  ValidateTopology(topology);
+  if (config.traffic.offered_load > 0) {
+    throw std::invalid_argument(
+        "Generated traffic is not supported in topology");
+  }
+
+  stations_count_ = 0;
+  segments_.resize(topology.segment_sizes.size());
+  for (size_t i = 0; i < segments_.size(); ++i) {
+    segments_[i].begin = stations_count_;
+    segments_[i].stations_count = topology.segment_sizes[i];
+    stations_count_ += topology.segment_sizes[i];
+  }
+  bridges_.resize(topology.bridges.size());
+  for (size_t i = 0; i < bridges_.size(); ++i) {
+    for (const size_t segment_index : topology.bridges[i]) {
+      auto& segment = segments_[segment_index];
+      bridges_[i].ports.push_back(ports_.size());
+      segment.ports.push_back(ports_.size());
+      ports_.push_back({i, segment_index,
+                        segment.stations_count + segment.ports.size() - 1});
+    }
+  }
+
+  // Ids of remote stations follow local ones in addresses of frames
+  size_t max_local_count = 0;
+  for (const auto& segment : segments_) {
+    max_local_count = std::max(max_local_count,
+                               segment.stations_count + segment.ports.size());
+  }
+  if (max_local_count + stations_count_ > kMaxStationsCount) {
+    throw std::invalid_argument(
+        "Too many stations to create, max count is " +
+        std::to_string(kMaxStationsCount - max_local_count));
+  }
+
+  // Payload is split between segments of sources keeping arrival order
+  std::vector<std::vector<Payload>> segments_payload(segments_.size());
+  for (size_t payload_id = 0; payload_id < payload_.GetSize(); ++payload_id) {
+    const Payload station_payload = GetPayload(payload_id);
+    if (station_payload.src_id >= stations_count_) {
+      throw std::invalid_argument("Bad payload: source id " +
+                                  std::to_string(station_payload.src_id) +
+                                  " points on nonexistent station");
+    }
+    const size_t dst_id = payload_.Get(payload_id).dst_id;
+    if (dst_id >= stations_count_ && !IsBroadcastDst(dst_id, stations_count_)) {
+      throw std::invalid_argument("Bad payload: destination id " +
+                                  std::to_string(dst_id) +
+                                  " points on nonexistent station");
+    }
+    const size_t segment_index = FindSegment(station_payload.src_id);
+    auto& segment = segments_[segment_index];
+    segments_payload[segment_index].push_back(
+        {station_payload.src_id - segment.begin,
+         GetLocalDst(segment, station_payload.dst_id), station_payload.data,
+         station_payload.arrival_tick});
+    segment.payload_ids.push_back(payload_id);
+  }
+
+  // Segments have own streams of random numbers, log is written by network
+  const uint64_t seed = config.seed ? *config.seed : std::random_device()();
+  for (size_t i = 0; i < segments_.size(); ++i) {
+    auto& segment = segments_[i];
+    EthernetConfig segment_config = config;
+    segment_config.threads_count = 1;
+    segment_config.log_format = LogFormat::kNone;
+    segment_config.seed = Random(seed, i)();
+    segment_config.bridge_ports_count = segment.ports.size();
+    segment_config.remote_stations_end =
+        segment.stations_count + segment.ports.size() + stations_count_;
+    segment.ethernet = std::make_unique<Ethernet>(
+        segment.stations_count + segment.ports.size(),
+        std::move(segments_payload[i]), log_stream, segment_config);
+    segment.ethernet->SetRecordsHandler(
+        [this, &segment](const std::vector<LogRecord>& records) {
+          HandleRecords(segment, records);
+        });
+  }
+
+  if (config.log_format != LogFormat::kNone) {
+    log_writer_ = std::make_unique<LogWriter>(
+        log_stream, config.log_format, stations_count_ + ports_.size(),
+        payload_);
+  }
+  workers_ = std::make_unique<WorkerPool>(
+      std::max<size_t>(1, std::min(config.threads_count, segments_.size())));
+}
+
+Network::~Network() = default;
+
+size_t Network::GetSegmentsCount() const { return segments_.size(); }
+
+const Metrics* Network::GetMetrics(size_t segment) const {
+  return segments_[segment].ethernet->GetMetrics();
+}
+
+size_t Network::GetTick() const {
+  return segments_.front().ethernet->GetTick();
+}
+
+bool Network::IsIdle() const {
+  return std::all_of(
+      segments_.begin(), segments_.end(),
+      [](const Segment& segment) { return segment.ethernet->IsIdle(); });
+}
+
+size_t Network::ProcessRound() {
+  // Round starts at the earliest event of segments, nothing can be forwarded
+  // before it
+  const size_t tick = GetTick();
+  std::optional<size_t> start_tick;
+  for (const auto& segment : segments_) {
+    if (segment.ethernet->IsIdle()) {
+      continue;
+    }
+    if (const auto next_event = segment.ethernet->GetNextEventTick()) {
+      start_tick = std::min(start_tick.value_or(SIZE_MAX), *next_event);
+    }
+  }
+  const size_t end_tick = std::max(tick, start_tick.value_or(tick)) + latency_;
+
+  // Segments do not interact until end of round
+  const size_t threads_count = workers_->GetThreadsCount();
+  workers_->Run([&](size_t thread) {
+    for (size_t i = thread; i < segments_.size(); i += threads_count) {
+      auto& ethernet = *segments_[i].ethernet;
+      while (ethernet.GetTick() < end_tick) {
+        ethernet.ProcessEvent(end_tick - ethernet.GetTick());
+      }
+    }
+  });
+
+  // Records of the same tick keep order of segments
+  for (auto& segment : segments_) {
+    records_.insert(records_.end(), segment.records.begin(),
+                    segment.records.end());
+    segment.records.clear();
+  }
+  std::stable_sort(records_.begin(), records_.end(),
+                   [](const LogRecord& lhs, const LogRecord& rhs) {
+                     return lhs.tick < rhs.tick;
+                   });
+  for (const auto& record : records_) {
+    if (record.event == LogEvent::kReceived &&
+        record.station_id >= stations_count_) {
+      ForwardFrame(record.station_id - stations_count_, record);
+    }
+  }
+  if (log_writer_) {
+    log_writer_->Write(records_);
+  }
+  records_.clear();
+  return end_tick - tick;
+}
+
+Payload Network::GetPayload(size_t payload_id) const {
+  Payload payload = payload_.Get(payload_id);
+  // Destination ids are checked on construction, ids out of stations range
+  // are broadcast
+  if (payload.dst_id >= stations_count_) {
+    payload.dst_id = kBroadcastId;
+  }
+  return payload;
+}
+
+size_t Network::FindSegment(size_t station_id) const {
+  const auto it = std::upper_bound(
+      segments_.begin(), segments_.end(), station_id,
+      [](size_t id, const Segment& segment) { return id < segment.begin; });
+  return it - segments_.begin() - 1;
+}
+
+size_t Network::GetLocalDst(const Segment& segment, size_t dst_id) const {
+  if (dst_id == kBroadcastId) {
+    return kBroadcastId;
+  }
+  if (dst_id >= segment.begin &&
+      dst_id < segment.begin + segment.stations_count) {
+    return dst_id - segment.begin;
+  }
+  return segment.stations_count + segment.ports.size() + dst_id;
+}
+
+void Network::HandleRecords(Segment& segment,
+                            const std::vector<LogRecord>& records) {
+  for (auto record : records) {
+    if (record.station_id != LogRecord::kUnknownId) {
+      record.station_id =
+          record.station_id < segment.stations_count
+              ? segment.begin + record.station_id
+              : stations_count_ +
+                    segment.ports[record.station_id - segment.stations_count];
+    }
+    if (record.payload_id != LogRecord::kUnknownId) {
+      record.payload_id = segment.payload_ids[record.payload_id];
+      // Forwarded frames are sent by ports, log shows original addresses
+      if (record.src_id != LogRecord::kUnknownId) {
+        const Payload station_payload = GetPayload(record.payload_id);
+        record.src_id = station_payload.src_id;
+        record.dst_id = station_payload.dst_id;
+      }
+    }
+    segment.records.push_back(record);
+  }
+}
+
+void Network::ForwardFrame(size_t port, const LogRecord& record) {
+  auto& bridge = bridges_[ports_[port].bridge];
+  const Payload station_payload = GetPayload(record.payload_id);
+  bridge.mac_table[station_payload.src_id] = port;
+
+  const uint64_t arrival_tick = record.tick + latency_;
+  if (station_payload.dst_id != kBroadcastId) {
+    const auto it = bridge.mac_table.find(station_payload.dst_id);
+    if (it != bridge.mac_table.end()) {
+      // Destination is in segment frame came from
+      if (it->second != port) {
+        SendFrame(it->second, record.payload_id, arrival_tick);
+      }
+      return;
+    }
+  }
+  // Broadcast and unknown destinations are flooded
+  for (const size_t other_port : bridge.ports) {
+    if (other_port != port) {
+      SendFrame(other_port, record.payload_id, arrival_tick);
+    }
+  }
+}
+
+void Network::SendFrame(size_t port, size_t payload_id, uint64_t arrival_tick) {
+  auto& segment = segments_[ports_[port].segment];
+  const Payload station_payload = GetPayload(payload_id);
+  segment.ethernet->AddPayload({ports_[port].local_id,
+                                GetLocalDst(segment, station_payload.dst_id),
+                                station_payload.data, arrival_tick});
+  segment.payload_ids.push_back(payload_id);
+}
+
+}  // namespace csma_cd
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "ethernet.hpp"
+
+namespace csma_cd {
+
+// Segments connected by bridges, bridges must not form loops as there is no
+// spanning tree protocol
+struct Topology {
+  // Count of stations in every segment
+  std::vector<size_t> segment_sizes;
+  // Indices of segments connected by every bridge
+  std::vector<std::vector<size_t>> bridges;
+  // Ticks from receiving frame by bridge port to queueing it on other ports
+  size_t latency = 1;
+};
+
+// Parses text lines "segment <stations count>", "bridge <segment>
+// <segment>...", "latency <ticks>", lines starting with '#' are skipped
+Topology ParseTopology(const std::string& path);
+
+// Ethernet segments connected by learning bridges. Stations have global ids
+// following segments order, bridge ports get ids after all stations. Every
+// bridge port is a station of its segment receiving all frames, frames are
+// forwarded by store and forward after topology latency
+class Network {
+ public:
+  // Payload uses global ids, log format and metrics are taken from config,
+  // threads count sets count of segments processed concurrently
+  Network(const Topology& topology, PayloadSource payload,
+          std::ostream& log_stream, const EthernetConfig& config);
+
+  // Records handlers of segments refer to network
+  Network(const Network&) = delete;
+  Network& operator=(const Network&) = delete;
+
+  ~Network();
+
+  size_t GetSegmentsCount() const;
+
+  // Statistics of segment, nullptr if not collected
+  const Metrics* GetMetrics(size_t segment) const;
+
+  size_t GetTick() const;
+
+  bool IsIdle() const;
+
+  // Processes all segments for ticks of topology latency, so frames
+  // forwarded in this round arrive not earlier than next one. Idle ticks are
+  // skipped in event mode, returns count of passed ticks
+  size_t ProcessRound();
+
+ private:
+  struct Segment {
+    // Global id of first station
+    size_t begin;
+    size_t stations_count;
+    // Global indices of bridge ports, local ids follow stations
+    std::vector<size_t> ports;
+    // Global ids of local payload
+    std::vector<size_t> payload_ids;
+    // Records of current round with global ids
+    std::vector<LogRecord> records;
+    std::unique_ptr<Ethernet> ethernet;
+  };
+
+  struct Port {
+    size_t bridge;
+    size_t segment;
+    size_t local_id;
+  };
+
+  struct Bridge {
+    std::vector<size_t> ports;
+    // Port behind which station was seen by its global id
+    std::unordered_map<size_t, size_t> mac_table;
+  };
+
+  // Loaded payload with destination ids out of stations range turned into
+  // broadcast
+  Payload GetPayload(size_t payload_id) const;
+
+  size_t FindSegment(size_t station_id) const;
+
+  // Local destination id of segment, stations of other segments follow ports
+  size_t GetLocalDst(const Segment& segment, size_t dst_id) const;
+
+  void HandleRecords(Segment& segment, const std::vector<LogRecord>& records);
+
+  // Learns source of frame received by port and queues it on other ports
+  void ForwardFrame(size_t port, const LogRecord& record);
+
+  void SendFrame(size_t port, size_t payload_id, uint64_t arrival_tick);
+
+ private:
+  const size_t latency_;
+  size_t stations_count_;
+  // Loaded payload with global ids, read by log writer
+  PayloadSource payload_;
+  std::vector<Segment> segments_;
+  std::vector<Port> ports_;
+  std::vector<Bridge> bridges_;
+  // Records of all segments in the order of ticks
+  std::vector<LogRecord> records_;
+  std::unique_ptr<LogWriter> log_writer_;
+  std::unique_ptr<WorkerPool> workers_;
+};
+
+}  // namespace csma_cd
@@ -0,0 +1,91 @@
+#include "pacer.hpp"
+
+#include <time.h>
+
+#include <cerrno>
+#include <cmath>
+#include <stdexcept>
+#include <system_error>
+
+#include "consts.hpp"
+
+namespace csma_cd {
+
+namespace {
+
+// Sleep may overshoot by timer slack, so last stretch is spun
+constexpr int64_t kSpinNanoseconds = 100000;
+constexpr int64_t kNanosecondsPerSecond = 1000000000;
+constexpr double kNanosecondsPerMicrosecond = 1000;
+
+int64_t GetMonotonicTime() {
+  timespec time{};
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec * kNanosecondsPerSecond + time.tv_nsec;
+}
+
+void SleepUntil(int64_t deadline) {
+  timespec time{};
+  time.tv_sec = deadline / kNanosecondsPerSecond;
+  time.tv_nsec = deadline % kNanosecondsPerSecond;
+  // Sleep is restarted if interrupted by signal, error is returned instead
+  // of being set in errno
+  int error;
+  while ((error = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &time,
+                                  nullptr)) == EINTR) {
+  }
+  if (error) {
+    throw std::system_error(error, std::generic_category(),
+                            "Failed to sleep until tick deadline");
+  }
+}
+
+}  // namespace
+
+Pacer::Pacer(uint64_t start_tick, double speed)
+    : start_tick_(start_tick),
+      tick_nanoseconds_(kTickDuration.count() / speed),
+      start_time_(GetMonotonicTime()),
+      late_ticks_(0) {
+  if (!(speed > 0)) {
+    throw std::invalid_argument("Real-time speed must be positive");
+  }
+}
+
+void Pacer::WaitForTick(uint64_t tick) {
+  const int64_t deadline = GetDeadline(tick);
+  int64_t now = GetMonotonicTime();
+  if (deadline - now > kSpinNanoseconds) {
+    SleepUntil(deadline - kSpinNanoseconds);
+    now = GetMonotonicTime();
+  }
+  while (now < deadline) {
+    now = GetMonotonicTime();
+  }
+  const int64_t lag = now - deadline;
+  lag_.Record(lag);
+  if (lag >= tick_nanoseconds_) {
+    ++late_ticks_;
+  }
+}
+
+const Histogram& Pacer::GetLag() const { return lag_; }
+
+uint64_t Pacer::GetLateTicks() const { return late_ticks_; }
+
+void Pacer::WriteReport(std::ostream& stream) const {
+  stream << "real-time lag: ticks " << lag_.GetCount() << ", late "
+         << late_ticks_ << ", mean "
+         << lag_.GetMean() / kNanosecondsPerMicrosecond << " us, p50 "
+         << lag_.GetPercentile(0.5) / kNanosecondsPerMicrosecond
+         << " us, p99 "
+         << lag_.GetPercentile(0.99) / kNanosecondsPerMicrosecond
+         << " us, max " << lag_.GetMax() / kNanosecondsPerMicrosecond
+         << " us\n";
+}
+
+int64_t Pacer::GetDeadline(uint64_t tick) const {
+  return start_time_ + std::llround((tick - start_tick_) * tick_nanoseconds_);
+}
+
+}  // namespace csma_cd
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+#include "metrics.hpp"
+
+namespace csma_cd {
+
+// Keeps simulated clock in step with monotonic wall clock. Deadline of every
+// tick is counted from start, so errors of single waits do not accumulate.
+// Late ticks are processed at once until simulation catches up
+class Pacer {
+ public:
+  // Speed is ratio of simulated time to wall time, first deadline is now
+  explicit Pacer(uint64_t start_tick, double speed = 1);
+
+  // Waits until deadline of tick: sleeps while it is far and spins on the
+  // last stretch, returns at once if deadline has passed
+  void WaitForTick(uint64_t tick);
+
+  // Lag of ticks behind their deadlines in nanoseconds
+  const Histogram& GetLag() const;
+
+  // Count of ticks late by a whole tick duration or more
+  uint64_t GetLateTicks() const;
+
+  // Writes one line with lag statistics in microseconds
+  void WriteReport(std::ostream& stream) const;
+
+ private:
+  int64_t GetDeadline(uint64_t tick) const;
+
+ private:
+  const uint64_t start_tick_;
+  const double tick_nanoseconds_;
+  int64_t start_time_;
+  Histogram lag_;
+  uint64_t late_ticks_;
+};
+
+}  // namespace csma_cd
@@ -0,0 +1,304 @@
+#include "payload_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace csma_cd {
+
+namespace {
+
+bool IsSpace(char c) { return std::isspace(static_cast<unsigned char>(c)); }
+
+// Parses decimal id at the start of text, skipping spaces before it
+size_t ParseId(std::string_view& text) {
+  while (!text.empty() && IsSpace(text.front())) {
+    text.remove_prefix(1);
+  }
+  size_t id = 0;
+  const auto [end, error] =
+      std::from_chars(text.data(), text.data() + text.size(), id);
+  if (error != std::errc()) {
+    throw std::invalid_argument("Bad payload: ids must be decimal numbers");
+  }
+  text.remove_prefix(end - text.data());
+  return id;
+}
+
+// Parses line "<src id> <dst id> <data>" at the start of text and skips it
+Payload ParseLine(std::string_view& text) {
+  const size_t src_id = ParseId(text);
+  const size_t dst_id = ParseId(text);
+
+  const size_t line_end = std::min(text.find('\n'), text.size());
+  std::string_view data = text.substr(0, line_end);
+  text.remove_prefix(line_end);
+  while (!data.empty() && IsSpace(data.front())) {
+    data.remove_prefix(1);
+  }
+  if (data.size() > kMaxDataLength) {
+    throw std::invalid_argument(
+        "Bad payload: data length must be less than 1500");
+  }
+  return {src_id, dst_id, data};
+}
+
+}  // namespace
+
+// Text lines indexed so far. Chunks of lines never move, so log writer thread
+// reads indexed lines while arrivals index next ones
+class PayloadSource::TextIndex {
+ public:
+  explicit TextIndex(std::string_view text)
+      : text_(text),
+        chunks_(text.size() / kMinLineSize / kChunkSize + 1),
+        count_(0) {}
+
+  // Parses next line, returns false at end of text
+  bool IndexLine() {
+    std::string_view rest = text_.substr(cursor_);
+    // Skip empty lines
+    while (!rest.empty() && IsSpace(rest.front())) {
+      rest.remove_prefix(1);
+    }
+    if (rest.empty()) {
+      cursor_ = text_.size();
+      return false;
+    }
+    const Payload payload = ParseLine(rest);
+    cursor_ = text_.size() - rest.size();
+    // Station ids are less than 2^24, while any larger destination means
+    // broadcast
+    if (payload.src_id > UINT32_MAX) {
+      throw std::invalid_argument("Bad payload: source id " +
+                                  std::to_string(payload.src_id) +
+                                  " points on nonexistent station");
+    }
+    const Line line{
+        static_cast<uint64_t>(payload.data.data() - text_.data()),
+        static_cast<uint32_t>(payload.data.size()),
+        static_cast<uint32_t>(payload.src_id),
+        static_cast<uint32_t>(
+            payload.dst_id > UINT32_MAX ? kBroadcastId : payload.dst_id)};
+
+    const size_t count = count_.load(std::memory_order_relaxed);
+    auto& chunk = chunks_[count / kChunkSize];
+    if (!chunk) {
+      chunk = std::make_unique<Line[]>(kChunkSize);
+    }
+    chunk[count % kChunkSize] = line;
+    count_.store(count + 1, std::memory_order_release);
+    return true;
+  }
+
+  size_t GetCount() const { return count_.load(std::memory_order_acquire); }
+
+  Payload Get(size_t id) const {
+    const Line& line = chunks_[id / kChunkSize][id % kChunkSize];
+    return {line.src_id, line.dst_id,
+            text_.substr(line.data_offset, line.data_size)};
+  }
+
+ private:
+  // Parsed line, several times smaller than payload
+  struct Line {
+    uint64_t data_offset : 48;
+    uint64_t data_size : 16;
+    uint32_t src_id;
+    uint32_t dst_id;
+  };
+
+  // Every line but last holds two ids and line break
+  static constexpr size_t kMinLineSize = 4;
+  static constexpr size_t kChunkSize = size_t{1} << 16u;
+
+  std::string_view text_;
+  size_t cursor_ = 0;
+  std::vector<std::unique_ptr<Line[]>> chunks_;
+  std::atomic<size_t> count_;
+};
+
+PayloadSource::PayloadSource() = default;
+
+PayloadSource::PayloadSource(std::vector<Payload> payload)
+    : payload_(std::move(payload)) {}
+
+PayloadSource::PayloadSource(const TraceRecord* records, size_t records_count,
+                             std::string_view data)
+    : records_(records), records_count_(records_count), data_(data) {}
+
+PayloadSource::PayloadSource(std::string_view text)
+    : text_index_(std::make_unique<TextIndex>(text)) {}
+
+PayloadSource::PayloadSource(PayloadSource&&) noexcept = default;
+
+PayloadSource& PayloadSource::operator=(PayloadSource&&) noexcept = default;
+
+PayloadSource::~PayloadSource() = default;
+
+size_t PayloadSource::GetSize() const {
+  if (text_index_) {
+    while (text_index_->IndexLine()) {
+    }
+    return text_index_->GetCount();
+  }
+  return records_ ? records_count_ : payload_.size();
+}
+
+bool PayloadSource::Contains(size_t id) const {
+  if (text_index_) {
+    while (text_index_->GetCount() <= id && text_index_->IndexLine()) {
+    }
+  }
+  return IsIndexed(id);
+}
+
+bool PayloadSource::IsIndexed(size_t id) const {
+  if (text_index_) {
+    return id < text_index_->GetCount();
+  }
+  return id < GetSize();
+}
+
+Payload PayloadSource::Get(size_t id) const {
+  if (text_index_) {
+    return text_index_->Get(id);
+  }
+  if (!records_) {
+    return payload_[id];
+  }
+  const auto& record = records_[id];
+  if (record.data_offset > data_.size() ||
+      record.data_size > data_.size() - record.data_offset) {
+    throw std::invalid_argument("Bad payload trace: data out of file");
+  }
+  if (record.data_size > kMaxDataLength) {
+    throw std::invalid_argument(
+        "Bad payload: data length must be less than 1500");
+  }
+  return {record.src_id, record.dst_id,
+          data_.substr(record.data_offset, record.data_size),
+          record.arrival_tick};
+}
+
+uint64_t PayloadSource::GetArrivalTick(size_t id) const {
+  // Text files queue all frames at start
+  if (text_index_) {
+    return 0;
+  }
+  return records_ ? records_[id].arrival_tick : payload_[id].arrival_tick;
+}
+
+PayloadFile::PayloadFile(const std::string& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::invalid_argument("Cannot open payload file " + path);
+  }
+  struct stat file_stat {};
+  if (fstat(fd, &file_stat) < 0) {
+    close(fd);
+    throw std::invalid_argument("Cannot read payload file " + path);
+  }
+  // Empty file cannot be mapped
+  if (file_stat.st_size == 0) {
+    close(fd);
+    return;
+  }
+  void* data =
+      mmap(nullptr, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    throw std::invalid_argument("Cannot read payload file " + path);
+  }
+  // Text and trace are read by arrival from start to end
+  madvise(data, file_stat.st_size, MADV_SEQUENTIAL);
+  content_ = {static_cast<const char*>(data),
+              static_cast<size_t>(file_stat.st_size)};
+}
+
+PayloadFile::~PayloadFile() {
+  if (!content_.empty()) {
+    munmap(const_cast<char*>(content_.data()), content_.size());
+  }
+}
+
+PayloadSource PayloadFile::Parse() const {
+  if (content_.size() >= sizeof(TraceHeader) &&
+      content_.compare(0, sizeof(TraceHeader::kMagic),
+                       std::string_view(TraceHeader::kMagic,
+                                        sizeof(TraceHeader::kMagic))) == 0) {
+    return ParseTrace();
+  }
+  return PayloadSource(content_);
+}
+
+PayloadSource PayloadFile::ParseTrace() const {
+  TraceHeader header{};
+  std::memcpy(&header, content_.data(), sizeof(header));
+  if (header.version != TraceHeader::kVersion) {
+    throw std::invalid_argument("Bad payload trace: unsupported version");
+  }
+  const size_t records_size = content_.size() - sizeof(header);
+  if (header.records_count > records_size / sizeof(TraceRecord) ||
+      header.data_size !=
+          records_size - header.records_count * sizeof(TraceRecord)) {
+    throw std::invalid_argument("Bad payload trace: truncated file");
+  }
+
+  // Mapping is page aligned, so records following header are aligned too
+  const auto* records =
+      reinterpret_cast<const TraceRecord*>(content_.data() + sizeof(header));
+  const std::string_view data = content_.substr(
+      sizeof(header) + header.records_count * sizeof(TraceRecord));
+  return {records, header.records_count, data};
+}
+
+void WriteTrace(const PayloadSource& payload, std::ostream& trace) {
+  // Lay out data blob storing every distinct data once
+  std::vector<TraceRecord> records;
+  records.reserve(payload.GetSize());
+  std::unordered_map<std::string_view, uint64_t> data_offsets;
+  std::vector<std::string_view> blob;
+  uint64_t data_size = 0;
+  for (size_t payload_id = 0; payload_id < payload.GetSize(); ++payload_id) {
+    const Payload frame_payload = payload.Get(payload_id);
+    const auto [it, is_new] =
+        data_offsets.emplace(frame_payload.data, data_size);
+    if (is_new) {
+      blob.push_back(frame_payload.data);
+      data_size += frame_payload.data.size();
+    }
+    if (frame_payload.src_id > UINT32_MAX ||
+        frame_payload.dst_id > UINT32_MAX) {
+      throw std::invalid_argument(
+          "Bad payload: ids must fit in 32 bits of trace record");
+    }
+    records.push_back({frame_payload.arrival_tick,
+                       static_cast<uint32_t>(frame_payload.src_id),
+                       static_cast<uint32_t>(frame_payload.dst_id), it->second,
+                       static_cast<uint32_t>(frame_payload.data.size()), 0});
+  }
+
+  TraceHeader header{};
+  std::memcpy(header.magic, TraceHeader::kMagic, sizeof(header.magic));
+  header.version = TraceHeader::kVersion;
+  header.records_count = records.size();
+  header.data_size = data_size;
+  trace.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  trace.write(reinterpret_cast<const char*>(records.data()),
+              records.size() * sizeof(TraceRecord));
+  for (const auto data : blob) {
+    trace.write(data.data(), data.size());
+  }
+}
+
+}  // namespace csma_cd
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "station.hpp"
+
+namespace csma_cd {
+
+// Header of binary payload trace, followed by records and data they refer to
+struct TraceHeader {
+  static constexpr char kMagic[8] = {'C', 'S', 'M', 'A', 'T', 'R', 'C', 0};
+  static constexpr uint32_t kVersion = 1;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t records_count;
+  uint64_t data_size;
+};
+
+struct TraceRecord {
+  // Tick frame is queued at, text files queue all frames at start
+  uint64_t arrival_tick;
+  uint32_t src_id;
+  uint32_t dst_id;
+  // Frames with equal data share it
+  uint64_t data_offset;
+  uint32_t data_size;
+  uint32_t reserved;
+};
+
+static_assert(sizeof(TraceHeader) == 32 && sizeof(TraceRecord) == 32,
+              "Binary trace layout changed");
+
+// Loaded payload ordered by arrival: frames built in memory, records of
+// mapped binary trace decoded when accessed or lines of mapped text indexed
+// when first reached, so file of any size is opened at once
+class PayloadSource {
+ public:
+  PayloadSource();
+  // Implicit, so frames built in memory are passed as they are
+  PayloadSource(std::vector<Payload> payload);
+  // Records and data must stay mapped while source is used
+  PayloadSource(const TraceRecord* records, size_t records_count,
+                std::string_view data);
+  // Text must stay mapped while source is used
+  explicit PayloadSource(std::string_view text);
+
+  PayloadSource(PayloadSource&&) noexcept;
+  PayloadSource& operator=(PayloadSource&&) noexcept;
+  ~PayloadSource();
+
+  // Indexes text up to its end
+  size_t GetSize() const;
+
+  // Indexes text only up to given id
+  bool Contains(size_t id) const;
+
+  // Does not index text, so may be called while other thread indexes it
+  bool IsIndexed(size_t id) const;
+
+  // Id must be contained, throws if trace record points out of data
+  Payload Get(size_t id) const;
+
+  // Id must be contained, text lines are not parsed again
+  uint64_t GetArrivalTick(size_t id) const;
+
+ private:
+  class TextIndex;
+
+  std::vector<Payload> payload_;
+  const TraceRecord* records_ = nullptr;
+  size_t records_count_ = 0;
+  std::string_view data_;
+  std::unique_ptr<TextIndex> text_index_;
+};
+
+// Payload file mapped into memory, pages are read by OS when accessed
+class PayloadFile {
+ public:
+  explicit PayloadFile(const std::string& path);
+
+  PayloadFile(const PayloadFile&) = delete;
+  PayloadFile& operator=(const PayloadFile&) = delete;
+
+  ~PayloadFile();
+
+  // Opens text lines "<src id> <dst id> <data>" or binary trace without
+  // reading them, payload data points into mapping and is valid while file is
+  // alive
+  PayloadSource Parse() const;
+
+ private:
+  PayloadSource ParseTrace() const;
+
+ private:
+  std::string_view content_;
+};
+
+// Writes payload as binary trace
+void WriteTrace(const PayloadSource& payload, std::ostream& trace);
+
+}  // namespace csma_cd
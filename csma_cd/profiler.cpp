@@ -0,0 +1,143 @@
+#include "profiler.hpp"
+
+#include <atomic>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace csma_cd::profiler {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* const kPhaseNames[] = {"tick", "scan",  "receive", "send",
+                                   "collision", "frame", "crc", "log"};
+
+static_assert(std::size(kPhaseNames) == static_cast<size_t>(Phase::kCount),
+              "Every phase needs a name");
+
+struct TraceEvent {
+  Phase phase;
+  Clock::time_point start;
+  std::chrono::nanoseconds duration;
+};
+
+// Counters of one thread, written only by it
+struct ThreadState {
+  size_t index = 0;
+  Stats stats;
+  Scope* current_scope = nullptr;
+  std::vector<TraceEvent> trace;
+};
+
+// States outlive their threads, so stats of finished workers are kept
+std::mutex states_mutex;
+std::vector<std::unique_ptr<ThreadState>> states;
+thread_local ThreadState* thread_state = nullptr;
+
+const Clock::time_point trace_origin = Clock::now();
+std::atomic<size_t> trace_interval{0};
+std::atomic<bool> is_tick_traced{false};
+uint64_t begun_ticks = 0;
+
+ThreadState& GetThreadState() {
+  if (!thread_state) {
+    std::lock_guard lock(states_mutex);
+    states.push_back(std::make_unique<ThreadState>());
+    thread_state = states.back().get();
+    thread_state->index = states.size() - 1;
+  }
+  return *thread_state;
+}
+
+PhaseStats& GetPhaseStats(Phase phase) {
+  return GetThreadState().stats[static_cast<size_t>(phase)];
+}
+
+}  // namespace
+
+Stats GetStats() {
+  Stats total;
+  std::lock_guard lock(states_mutex);
+  for (const auto& state : states) {
+    for (size_t i = 0; i < total.size(); ++i) {
+      total[i].calls += state->stats[i].calls;
+      total[i].nanoseconds += state->stats[i].nanoseconds;
+      total[i].events += state->stats[i].events;
+    }
+  }
+  return total;
+}
+
+void WriteSummary(std::ostream& stream, uint64_t ticks) {
+  const Stats stats = GetStats();
+  stream << "{\"ticks\": " << ticks;
+  for (size_t i = 0; i < stats.size(); ++i) {
+    stream << ", \"" << kPhaseNames[i] << "\": {\"calls\": " << stats[i].calls
+           << ", \"ns\": " << stats[i].nanoseconds
+           << ", \"events\": " << stats[i].events << "}";
+  }
+  stream << "}\n";
+}
+
+void EnableTrace(size_t sample_interval) {
+  trace_interval.store(sample_interval, std::memory_order_relaxed);
+}
+
+void BeginTick() {
+  const size_t interval = trace_interval.load(std::memory_order_relaxed);
+  is_tick_traced.store(interval && begun_ticks % interval == 0,
+                       std::memory_order_relaxed);
+  ++begun_ticks;
+}
+
+void WriteTrace(std::ostream& stream) {
+  std::lock_guard lock(states_mutex);
+  stream << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [";
+  bool is_first = true;
+  for (const auto& state : states) {
+    for (const auto& event : state->trace) {
+      const std::chrono::duration<double, std::micro> start =
+          event.start - trace_origin;
+      const std::chrono::duration<double, std::micro> duration =
+          event.duration;
+      stream << (is_first ? "\n" : ",\n") << "{\"name\": \""
+             << kPhaseNames[static_cast<size_t>(event.phase)]
+             << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << state->index
+             << ", \"ts\": " << start.count()
+             << ", \"dur\": " << duration.count() << "}";
+      is_first = false;
+    }
+  }
+  stream << "\n]}\n";
+}
+
+void Count(Phase phase, uint64_t events) {
+  GetPhaseStats(phase).events += events;
+}
+
+Scope::Scope(Phase phase)
+    : phase_(phase),
+      start_(Clock::now()),
+      parent_(GetThreadState().current_scope),
+      nested_(0) {
+  thread_state->current_scope = this;
+}
+
+Scope::~Scope() {
+  const auto duration = Clock::now() - start_;
+  thread_state->current_scope = parent_;
+  if (parent_) {
+    parent_->nested_ += duration;
+  }
+  auto& stats = thread_state->stats[static_cast<size_t>(phase_)];
+  ++stats.calls;
+  stats.nanoseconds += (duration - nested_).count();
+  if (is_tick_traced.load(std::memory_order_relaxed)) {
+    thread_state->trace.push_back({phase_, start_, duration});
+  }
+}
+
+}  // namespace csma_cd::profiler
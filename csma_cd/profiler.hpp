@@ -0,0 +1,90 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace csma_cd::profiler {
+
+// Phases of tick, time of nested phase is not counted in enclosing one
+enum class Phase : uint8_t {
+  kTick,       // rest of tick: station iteration, wakeups, bus bookkeeping
+  kScan,       // ticking sleep timers of all stations
+  kReceive,    // stations receiving frames
+  kSend,       // stations sending frames and backing off
+  kCollision,  // merging senders and jamming bus
+  kFrame,      // building frame put on bus
+  kCrc,        // computing frame checksums
+  kLog,        // passing records to metrics, log writer and handler
+  kCount,
+};
+
+// Profiling code is compiled only with CSMA_CD_PROFILE defined
+#ifdef CSMA_CD_PROFILE
+constexpr bool kIsEnabled = true;
+#else
+constexpr bool kIsEnabled = false;
+#endif
+
+struct PhaseStats {
+  uint64_t calls = 0;
+  uint64_t nanoseconds = 0;
+  // Phase-specific count: collisions, frames, checksums, records
+  uint64_t events = 0;
+};
+
+using Stats = std::array<PhaseStats, static_cast<size_t>(Phase::kCount)>;
+
+// Sum of stats of all threads, must not run concurrently with ticks
+Stats GetStats();
+
+// Writes cumulative stats as one JSON object per line
+void WriteSummary(std::ostream& stream, uint64_t ticks);
+
+// Records phases of every n-th processed tick for trace, zero disables it
+void EnableTrace(size_t sample_interval);
+
+// Marks start of tick on thread processing ticks
+void BeginTick();
+
+// Writes recorded phases in Chrome trace event format
+void WriteTrace(std::ostream& stream);
+
+void Count(Phase phase, uint64_t events);
+
+// Times phase from construction to destruction
+class Scope {
+ public:
+  explicit Scope(Phase phase);
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+  ~Scope();
+
+ private:
+  const Phase phase_;
+  const std::chrono::steady_clock::time_point start_;
+  Scope* const parent_;
+  // Time of nested scopes
+  std::chrono::nanoseconds nested_;
+};
+
+}  // namespace csma_cd::profiler
+
+#define CSMA_CD_PROFILE_CONCAT_IMPL(a, b) a##b
+#define CSMA_CD_PROFILE_CONCAT(a, b) CSMA_CD_PROFILE_CONCAT_IMPL(a, b)
+
+#ifdef CSMA_CD_PROFILE
+#define CSMA_CD_PROFILE_SCOPE(phase)                               \
+  const ::csma_cd::profiler::Scope CSMA_CD_PROFILE_CONCAT(         \
+      profile_scope_, __LINE__)(::csma_cd::profiler::Phase::phase)
+#define CSMA_CD_PROFILE_COUNT(phase, events) \
+  ::csma_cd::profiler::Count(::csma_cd::profiler::Phase::phase, events)
+#define CSMA_CD_PROFILE_TICK() ::csma_cd::profiler::BeginTick()
+#else
+#define CSMA_CD_PROFILE_SCOPE(phase)
+#define CSMA_CD_PROFILE_COUNT(phase, events)
+#define CSMA_CD_PROFILE_TICK()
+#endif
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <limits>
+
+namespace csma_cd {
+
+// xoshiro256** generator, small state lets every station own its stream
+class Random {
+ public:
+  using result_type = uint64_t;
+
+  // Streams with different ids are independent for the same seed
+  Random(uint64_t seed, uint64_t stream) {
+    // Expand seed with SplitMix64 as recommended by xoshiro authors
+    uint64_t x = seed ^ (stream * 0xd1b54a32d192ed03u);
+    for (auto& word : state_) {
+      x += 0x9e3779b97f4a7c15u;
+      uint64_t z = x;
+      z = (z ^ (z >> 30u)) * 0xbf58476d1ce4e5b9u;
+      z = (z ^ (z >> 27u)) * 0x94d049bb133111ebu;
+      word = z ^ (z >> 31u);
+    }
+  }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  result_type operator()() {
+    const uint64_t result = Rotate(state_[1] * 5, 7) * 9;
+    const uint64_t t = state_[1] << 17u;
+    state_[2] ^= state_[0];
+    state_[3] ^= state_[1];
+    state_[1] ^= state_[2];
+    state_[0] ^= state_[3];
+    state_[2] ^= t;
+    state_[3] = Rotate(state_[3], 45);
+    return result;
+  }
+
+ private:
+  static uint64_t Rotate(uint64_t x, int k) {
+    return (x << k) | (x >> (64 - k));
+  }
+
+ private:
+  std::array<uint64_t, 4> state_;
+};
+
+}  // namespace csma_cd
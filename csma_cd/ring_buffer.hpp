@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+namespace csma_cd {
+
+// Lock-free queue for one producer thread and one consumer thread
+template <typename T>
+class RingBuffer {
+ public:
+  // Capacity is rounded up to power of two
+  explicit RingBuffer(size_t capacity);
+
+  // Returns count of pushed items, less than size if buffer is full
+  size_t Push(const T* items, size_t size);
+
+  // Returns count of popped items, zero if buffer is empty
+  size_t Pop(T* items, size_t size);
+
+ private:
+  std::vector<T> buffer_;
+  size_t mask_;
+  alignas(64) std::atomic<size_t> head_;
+  alignas(64) std::atomic<size_t> tail_;
+};
+
+template <typename T>
+RingBuffer<T>::RingBuffer(size_t capacity) : head_(0), tail_(0) {
+  size_t size = 1;
+  while (size < capacity) {
+    size <<= 1u;
+  }
+  buffer_.resize(size);
+  mask_ = size - 1;
+}
+
+template <typename T>
+size_t RingBuffer<T>::Push(const T* items, size_t size) {
+  const size_t tail = tail_.load(std::memory_order_relaxed);
+  const size_t head = head_.load(std::memory_order_acquire);
+  const size_t count = std::min(size, buffer_.size() - (tail - head));
+  for (size_t i = 0; i < count; ++i) {
+    buffer_[(tail + i) & mask_] = items[i];
+  }
+  tail_.store(tail + count, std::memory_order_release);
+  return count;
+}
+
+template <typename T>
+size_t RingBuffer<T>::Pop(T* items, size_t size) {
+  const size_t head = head_.load(std::memory_order_relaxed);
+  const size_t tail = tail_.load(std::memory_order_acquire);
+  const size_t count = std::min(size, tail - head);
+  for (size_t i = 0; i < count; ++i) {
+    items[i] = buffer_[(head + i) & mask_];
+  }
+  head_.store(head + count, std::memory_order_release);
+  return count;
+}
+
+}  // namespace csma_cd
@@ -0,0 +1,79 @@
+#include "simulation.hpp"
+
+namespace csma_cd {
+
+namespace {
+
+EthernetConfig GetEthernetConfig(const SimulationConfig& config) {
+  EthernetConfig ethernet_config = config.ethernet;
+  ethernet_config.log_format = LogFormat::kNone;
+  return ethernet_config;
+}
+
+}  // namespace
+
+Simulation::Simulation(const SimulationConfig& config,
+                       std::vector<Payload> payload)
+    : null_stream_(nullptr),
+      ethernet_(config.stations_count, std::move(payload), null_stream_,
+                GetEthernetConfig(config)) {}
+
+void Simulation::PushFrame(size_t src_id, size_t dst_id, std::string_view data,
+                           std::optional<uint64_t> arrival_tick) {
+  pushed_data_.emplace_back(data);
+  try {
+    ethernet_.AddPayload({src_id, dst_id, pushed_data_.back(),
+                          arrival_tick.value_or(GetTick())});
+  } catch (...) {
+    pushed_data_.pop_back();
+    throw;
+  }
+}
+
+void Simulation::Subscribe(EventCallback callback) {
+  // Records are not passed anywhere until someone listens
+  if (callbacks_.empty()) {
+    ethernet_.SetRecordsHandler(
+        [this](const std::vector<LogRecord>& records) {
+          HandleRecords(records);
+        });
+  }
+  callbacks_.push_back(std::move(callback));
+}
+
+void Simulation::Step(size_t ticks) {
+  const uint64_t end_tick = GetTick() + ticks;
+  while (GetTick() < end_tick) {
+    ethernet_.ProcessEvent(end_tick - GetTick());
+  }
+}
+
+size_t Simulation::RunUntilIdle() {
+  const uint64_t start_tick = GetTick();
+  while (!ethernet_.IsIdle()) {
+    ethernet_.ProcessEvent();
+  }
+  return GetTick() - start_tick;
+}
+
+bool Simulation::IsIdle() const { return ethernet_.IsIdle(); }
+
+uint64_t Simulation::GetTick() const { return ethernet_.GetTick(); }
+
+Payload Simulation::GetPayload(size_t payload_id) const {
+  return ethernet_.GetPayload(payload_id);
+}
+
+const Metrics* Simulation::GetMetrics() const {
+  return ethernet_.GetMetrics();
+}
+
+void Simulation::HandleRecords(const std::vector<LogRecord>& records) const {
+  for (const auto& record : records) {
+    for (const auto& callback : callbacks_) {
+      callback(record);
+    }
+  }
+}
+
+}  // namespace csma_cd
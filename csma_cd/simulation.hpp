@@ -0,0 +1,72 @@
+#pragma once
+
+#include <deque>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "ethernet.hpp"
+
+namespace csma_cd {
+
+struct SimulationConfig {
+  size_t stations_count = 1;
+  // Log format is ignored, events are delivered to subscribers instead
+  EthernetConfig ethernet;
+};
+
+// Simulation driven by embedding program: frames are pushed and ticks are
+// processed on demand, events are reported through callbacks
+class Simulation {
+ public:
+  using EventCallback = std::function<void(const LogRecord& record)>;
+
+  // Data of initial payload must outlive simulation
+  explicit Simulation(const SimulationConfig& config,
+                      std::vector<Payload> payload = {});
+
+  // Subscribers refer to simulation
+  Simulation(const Simulation&) = delete;
+  Simulation& operator=(const Simulation&) = delete;
+
+  // Queues copy of frame data at given tick, current tick by default.
+  // Destination id equal to stations count or broadcast id means broadcast
+  void PushFrame(size_t src_id, size_t dst_id, std::string_view data,
+                 std::optional<uint64_t> arrival_tick = std::nullopt);
+
+  // Callback is called for every event in the order of logging, payload of
+  // event can be looked up by GetPayload while callback runs
+  void Subscribe(EventCallback callback);
+
+  // Processes given count of ticks, idle ticks are skipped in event mode
+  void Step(size_t ticks);
+
+  // Processes ticks until all frames are sent or dropped, returns count of
+  // passed ticks
+  size_t RunUntilIdle();
+
+  bool IsIdle() const;
+
+  uint64_t GetTick() const;
+
+  // Pushed payload is kept until tick where it is sent or dropped ends
+  Payload GetPayload(size_t payload_id) const;
+
+  // Nullptr unless metrics are enabled in config
+  const Metrics* GetMetrics() const;
+
+ private:
+  void HandleRecords(const std::vector<LogRecord>& records) const;
+
+ private:
+  std::ostream null_stream_;
+  Ethernet ethernet_;
+  // Copies of pushed data, deque keeps them in place
+  std::deque<std::string> pushed_data_;
+  std::vector<EventCallback> callbacks_;
+};
+
+}  // namespace csma_cd
@@ -1,137 +1,445 @@
 #include "station.hpp"
 
+#include <algorithm>
+#include <cstdint>
+
 #include "ethernet.hpp"
-#include "utils.hpp"
+#include "profiler.hpp"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CSMA_CD_HAS_AVX2_TIMERS
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// Ticks timers of at most 64 stations starting from given ones, returns mask
+// of stations ready to send
+uint64_t TickSleepTimersScalar(uint32_t* sleep_timers,
+                               const uint8_t* is_sending_frame,
+                               const uint8_t* has_payload, size_t count) {
+  uint64_t bits = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (sleep_timers[i]) {
+      --sleep_timers[i];
+    } else if (!is_sending_frame[i] && has_payload[i]) {
+      bits |= uint64_t{1} << i;
+    }
+  }
+  return bits;
+}
+
+#ifdef CSMA_CD_HAS_AVX2_TIMERS
+
+__attribute__((target("avx2"))) uint64_t TickSleepTimersAvx2(
+    uint32_t* sleep_timers, const uint8_t* is_sending_frame,
+    const uint8_t* has_payload, size_t count) {
+  if (count < 64) {
+    return TickSleepTimersScalar(sleep_timers, is_sending_frame, has_payload,
+                                 count);
+  }
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i all_ones = _mm256_set1_epi32(-1);
+  // Decrement non-zero timers by adding -1 to them
+  uint64_t is_awake = 0;
+  for (size_t i = 0; i < 64; i += 8) {
+    auto* timers = reinterpret_cast<__m256i*>(sleep_timers + i);
+    const __m256i value = _mm256_loadu_si256(timers);
+    const __m256i is_zero = _mm256_cmpeq_epi32(value, zero);
+    _mm256_storeu_si256(
+        timers, _mm256_add_epi32(value, _mm256_andnot_si256(is_zero, all_ones)));
+    is_awake |= static_cast<uint64_t>(
+                    _mm256_movemask_ps(_mm256_castsi256_ps(is_zero)))
+                << i;
+  }
+  // Station can send if it has payload and is not sending already
+  uint64_t can_send = 0;
+  for (size_t i = 0; i < 64; i += 32) {
+    const __m256i sending = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(is_sending_frame + i));
+    const __m256i payload = _mm256_loadu_si256(
+        reinterpret_cast<const __m256i*>(has_payload + i));
+    const __m256i ready = _mm256_andnot_si256(
+        _mm256_cmpeq_epi8(payload, zero), _mm256_cmpeq_epi8(sending, zero));
+    can_send |= static_cast<uint64_t>(
+                    static_cast<uint32_t>(_mm256_movemask_epi8(ready)))
+                << i;
+  }
+  return is_awake & can_send;
+}
+
+#endif
+
+using TickSleepTimersFunction = uint64_t (*)(uint32_t*, const uint8_t*,
+                                             const uint8_t*, size_t);
+
+// Chosen once on startup according to CPU features
+const TickSleepTimersFunction tick_sleep_timers_impl =
+#ifdef CSMA_CD_HAS_AVX2_TIMERS
+    __builtin_cpu_supports("avx2") ? TickSleepTimersAvx2 :
+#endif
+                                   TickSleepTimersScalar;
+
+}  // namespace
 
 namespace csma_cd {
 
-Station::Station(size_t id, const Ethernet& ethernet, int rand_seed)
+bool IsBroadcastDst(size_t dst_id, size_t stations_count) {
+  return dst_id == stations_count || dst_id == kBroadcastId ||
+         dst_id >= std::max(stations_count, kLegacyBroadcastId);
+}
+
+PayloadQueues::PayloadQueues(size_t stations_count)
+    : heads_(stations_count, kNoNode),
+      tails_(stations_count, kNoNode),
+      free_heads_(stations_count, kNoNode) {}
+
+bool PayloadQueues::IsEmpty(size_t station_id) const {
+  return heads_[station_id] == kNoNode;
+}
+
+size_t PayloadQueues::Front(size_t station_id) const {
+  return nodes_[heads_[station_id]].payload_id;
+}
+
+void PayloadQueues::Push(size_t station_id, size_t payload_id) {
+  uint32_t node = free_heads_[station_id];
+  if (node != kNoNode) {
+    free_heads_[station_id] = nodes_[node].next;
+  } else {
+    node = nodes_.size();
+    nodes_.emplace_back();
+  }
+  nodes_[node] = {static_cast<uint32_t>(payload_id), kNoNode};
+
+  if (tails_[station_id] == kNoNode) {
+    heads_[station_id] = node;
+  } else {
+    nodes_[tails_[station_id]].next = node;
+  }
+  tails_[station_id] = node;
+}
+
+void PayloadQueues::Pop(size_t station_id) {
+  const uint32_t node = heads_[station_id];
+  heads_[station_id] = nodes_[node].next;
+  if (heads_[station_id] == kNoNode) {
+    tails_[station_id] = kNoNode;
+  }
+  nodes_[node].next = free_heads_[station_id];
+  free_heads_[station_id] = node;
+}
+
+void PayloadQueues::Save(CheckpointWriter& writer) const {
+  std::vector<uint32_t> sizes(heads_.size());
+  std::vector<uint32_t> payload_ids;
+  for (size_t id = 0; id < heads_.size(); ++id) {
+    for (uint32_t node = heads_[id]; node != kNoNode;
+         node = nodes_[node].next) {
+      payload_ids.push_back(nodes_[node].payload_id);
+      ++sizes[id];
+    }
+  }
+  writer.WriteArray(sizes.data(), sizes.size());
+  writer.WriteArray(payload_ids.data(), payload_ids.size());
+}
+
+void PayloadQueues::Load(CheckpointReader& reader) {
+  std::vector<uint32_t> sizes(heads_.size());
+  reader.ReadArray(sizes.data(), sizes.size());
+
+  // Ids are read one by one, so corrupted sizes end with truncated file
+  // instead of huge allocation
+  *this = PayloadQueues(sizes.size());
+  for (size_t id = 0; id < sizes.size(); ++id) {
+    for (uint32_t i = 0; i < sizes[id]; ++i) {
+      uint32_t payload_id = 0;
+      reader.Read(payload_id);
+      Push(id, payload_id);
+    }
+  }
+}
+
+StationTable::StationTable(size_t stations_count)
+    : sleep_timers(stations_count, 0),
+      retry_counts(stations_count, 0),
+      is_receiving_frame(stations_count, false),
+      is_sending_frame(stations_count, false),
+      has_payload(stations_count, false),
+      ready_mask((stations_count + 63) / 64, 0),
+      active_mask((stations_count + 63) / 64, 0),
+      payload_stations_count(0),
+      payload_queues(stations_count) {}
+
+bool StationTable::IsIdle() const {
+  // Sleeping and sending stations always have payload
+  return payload_stations_count.load(std::memory_order_relaxed) == 0;
+}
+
+void StationTable::SkipTicks(size_t ticks) {
+  const uint32_t skipped = std::min<size_t>(ticks, UINT32_MAX);
+  // Only active stations have running timers
+  for (size_t word = 0; word < active_mask.size(); ++word) {
+    if (!active_mask[word]) {
+      continue;
+    }
+    const size_t end = std::min(sleep_timers.size(), (word + 1) * 64);
+    for (size_t id = word * 64; id < end; ++id) {
+      sleep_timers[id] -= std::min(sleep_timers[id], skipped);
+    }
+  }
+}
+
+std::optional<size_t> StationTable::GetWakeupDelay(bool is_bus_awaited,
+                                                   size_t enough_delay) const {
+  std::optional<size_t> delay;
+  for (size_t word = 0; word < active_mask.size(); ++word) {
+    for (uint64_t bits = active_mask[word]; bits; bits &= bits - 1) {
+      const size_t id = word * 64 + __builtin_ctzll(bits);
+      if (!has_payload[id]) {
+        continue;
+      }
+      size_t station_delay = sleep_timers[id];
+      if (!station_delay && (is_sending_frame[id] || is_bus_awaited)) {
+        continue;
+      }
+      if (!delay || station_delay < *delay) {
+        delay = station_delay;
+        if (station_delay <= enough_delay) {
+          return delay;
+        }
+      }
+    }
+  }
+  return delay;
+}
+
+void StationTable::TickSleepTimers() {
+  for (size_t word = 0; word < active_mask.size(); ++word) {
+    if (!active_mask[word]) {
+      ready_mask[word] = 0;
+      continue;
+    }
+    const size_t id = word * 64;
+    ready_mask[word] = tick_sleep_timers_impl(
+        sleep_timers.data() + id, is_sending_frame.data() + id,
+        has_payload.data() + id, std::min<size_t>(64, sleep_timers.size() - id));
+  }
+}
+
+void StationTable::Save(CheckpointWriter& writer) const {
+  writer.WriteArray(sleep_timers.data(), sleep_timers.size());
+  writer.WriteArray(retry_counts.data(), retry_counts.size());
+  writer.WriteArray(is_receiving_frame.data(), is_receiving_frame.size());
+  writer.WriteArray(is_sending_frame.data(), is_sending_frame.size());
+  payload_queues.Save(writer);
+}
+
+void StationTable::Load(CheckpointReader& reader) {
+  reader.ReadArray(sleep_timers.data(), sleep_timers.size());
+  reader.ReadArray(retry_counts.data(), retry_counts.size());
+  reader.ReadArray(is_receiving_frame.data(), is_receiving_frame.size());
+  reader.ReadArray(is_sending_frame.data(), is_sending_frame.size());
+  payload_queues.Load(reader);
+  std::fill(active_mask.begin(), active_mask.end(), 0);
+  size_t count = 0;
+  for (size_t id = 0; id < has_payload.size(); ++id) {
+    has_payload[id] = !payload_queues.IsEmpty(id);
+    count += has_payload[id];
+    if (has_payload[id] || is_receiving_frame[id]) {
+      active_mask[id / 64] |= uint64_t{1} << (id % 64);
+    }
+  }
+  payload_stations_count = count;
+}
+
+Station::Station(size_t id, StationTable& table, const Ethernet& ethernet,
+                 Logger& logger, const MacParams& mac, const Random& rand_gen)
     : id_(id),
-      sleep_timer_(0),
-      is_receiving_frame_(false),
-      is_sending_frame_(false),
-      retry_count_(0),
-      rand_gen_(rand_seed),
+      rand_gen_(rand_gen),
+      table_(table),
       ethernet_(ethernet),
-      logger_(ethernet.GetLogger()) {}
+      logger_(logger),
+      mac_(mac) {}
 
-void Station::AddPayload(Payload&& payload) {
-  payload_queue_.push(std::move(payload));
+void Station::AddPayload(size_t payload_id) {
+  table_.payload_queues.Push(id_, payload_id);
+  if (!table_.has_payload[id_]) {
+    table_.has_payload[id_] = true;
+    table_.payload_stations_count.fetch_add(1, std::memory_order_relaxed);
+    UpdateActivity();
+  }
 }
 
 bool Station::IsIdle() const {
-  return sleep_timer_ == 0 && !is_sending_frame_ && payload_queue_.empty();
+  return table_.sleep_timers[id_] == 0 && !table_.is_sending_frame[id_] &&
+         table_.payload_queues.IsEmpty(id_);
 }
 
-std::optional<Payload> Station::ProcessTick() {
+template <typename Policy>
+std::optional<size_t> Station::ProcessTick() {
   ProcessReceive();
-  return ProcessSend();
+  const auto payload_id = ProcessSend<Policy>();
+  UpdateActivity();
+  return payload_id;
 }
 
+void Station::Save(CheckpointWriter& writer) const {
+  writer.Write(rand_gen_);
+}
+
+void Station::Load(CheckpointReader& reader) { reader.Read(rand_gen_); }
+
 void Station::ProcessReceive() {
+  CSMA_CD_PROFILE_SCOPE(kReceive);
   // Stop receiving if collision happened
   if (ethernet_.IsJammed()) {
-    is_receiving_frame_ = false;
+    table_.is_receiving_frame[id_] = false;
   }
   // Try receive frame from bus
-  std::optional<Frame> bus_frame = ethernet_.GetFrameFromBus();
+  const BusFrame* bus_frame = ethernet_.GetFrameFromBus();
   if (bus_frame && !ethernet_.IsJammed()) {
-    const auto checksum =
-        utils::CRC32(0, reinterpret_cast<const uint8_t*>(&*bus_frame),
-                     sizeof(*bus_frame) - 4);
-    if (bus_frame->start_of_frame_delim == 0xab &&
-        checksum == bus_frame->checksum) {
-      const auto src_id = utils::ExctractId(bus_frame->source_address);
-      const auto dst_id = utils::ExctractId(bus_frame->destination_address);
-      const auto is_broadcast = dst_id && *dst_id >= kMaxStationsCount &&
-                                (bus_frame->destination_address[0] >> 7u);
-      if ((is_broadcast || dst_id == id_) && src_id != id_) {
+    const bool is_valid = ethernet_.IsParanoidCrc() ? bus_frame->IsIntact()
+                                                    : bus_frame->is_valid;
+    if (is_valid) {
+      if ((bus_frame->is_broadcast || bus_frame->dst_id == id_ ||
+           ethernet_.IsBridgePort(id_)) &&
+          bus_frame->src_id != id_) {
         if (ethernet_.IsNewFrameStart()) {
           ForceStopReceive();
-          logger_.LogFrame(*bus_frame, id_, "start receiving frame");
-          is_receiving_frame_ = true;
+          logger_.LogFrame(*bus_frame, id_, LogEvent::kStartReceiving);
+          table_.is_receiving_frame[id_] = true;
         } else if (ethernet_.IsFree()) {
-          if (is_receiving_frame_) {
-            logger_.LogFrame(*bus_frame, id_, "successfully received frame");
+          if (table_.is_receiving_frame[id_]) {
+            logger_.LogFrame(*bus_frame, id_, LogEvent::kReceived);
           } else {
-            logger_.LogFrame(*bus_frame, id_, "!!! missed frame");
+            logger_.LogFrame(*bus_frame, id_, LogEvent::kMissed);
           }
-          is_receiving_frame_ = false;
+          table_.is_receiving_frame[id_] = false;
         }
       } else {
         ForceStopReceive();
       }
     } else {
-      logger_.LogMessage(id_, "!!! received corrupted frame");
+      logger_.LogMessage(id_, LogEvent::kCorruptedFrame);
       ForceStopReceive();
     }
   }
 }
 
-std::optional<Payload> Station::ProcessSend() {
+template <typename Policy>
+std::optional<size_t> Station::ProcessSend() {
+  CSMA_CD_PROFILE_SCOPE(kSend);
   // Continue sleep if needed
-  if (sleep_timer_) {
-    --sleep_timer_;
+  if (table_.sleep_timers[id_]) {
+    --table_.sleep_timers[id_];
     return std::nullopt;
   }
   // If sending frame, check for collision in bus
-  if (is_sending_frame_) {
+  if (table_.is_sending_frame[id_]) {
     if (ethernet_.IsJammed()) {
-      is_sending_frame_ = false;
+      table_.is_sending_frame[id_] = false;
 
-      if (++retry_count_ > kMaxRetries) {
-        logger_.LogPayload(payload_queue_.front(), id_,
-                           "max retries exceeded while sending frame");
+      if (++table_.retry_counts[id_] > mac_.max_retries) {
+        LogPayload(LogEvent::kMaxRetriesExceeded);
         ForceStopSend();
         return std::nullopt;
       }
 
-      logger_.LogMessage(id_, "retry count = " + std::to_string(retry_count_));
-      StartSleep();
+      logger_.LogMessage(id_, LogEvent::kRetry, table_.retry_counts[id_]);
+      StartSleep<Policy>();
       return std::nullopt;
     }
     if (ethernet_.IsFree()) {
-      logger_.LogPayload(payload_queue_.front(), id_, "finish sending frame");
+      LogPayload(LogEvent::kFinishSending);
       ForceStopSend();
     } else {
       return std::nullopt;
     }
   }
   // Try send payload from queue
-  if (!payload_queue_.empty()) {
+  if (table_.has_payload[id_]) {
     if (ethernet_.IsFree()) {
-      is_sending_frame_ = true;
-      logger_.LogPayload(payload_queue_.front(), id_, "start sending frame");
-      return payload_queue_.front();
+      // Defer to next slot with probability 1 - p
+      if constexpr (Policy::kPersistence == Persistence::kPPersistent) {
+        if ((rand_gen_() >> 32u) >= mac_.send_threshold) {
+          table_.sleep_timers[id_] = mac_.slot_ticks - 1;
+          return std::nullopt;
+        }
+      }
+      table_.is_sending_frame[id_] = true;
+      LogPayload(LogEvent::kStartSending);
+      return table_.payload_queues.Front(id_);
     }
 
-    StartSleep();
+    // Persistent stations sense bus on every tick until it is free
+    if constexpr (Policy::kPersistence == Persistence::kNonPersistent) {
+      StartSleep<Policy>();
+    }
   }
   // Idle tick
   return std::nullopt;
 }
 
+template <typename Policy>
 void Station::StartSleep() {
-  const size_t max_delay =
-      std::pow(2, std::min(kMaxSleepIncrease, retry_count_));
-  std::uniform_int_distribution<size_t> delay(0, max_delay);
-  sleep_timer_ = delay(rand_gen_);
+  std::uniform_int_distribution<size_t> delay(
+      0, Policy::GetMaxDelay(table_.retry_counts[id_], mac_.backoff_limit));
+  table_.sleep_timers[id_] = delay(rand_gen_) * mac_.slot_ticks;
+}
+
+void Station::LogPayload(LogEvent event) {
+  const size_t payload_id = table_.payload_queues.Front(id_);
+  logger_.LogPayload(ethernet_.GetPayload(payload_id), payload_id, id_, event);
+}
+
+void Station::UpdateActivity() {
+  const uint64_t bit = uint64_t{1} << (id_ % 64);
+  uint64_t& word = table_.active_mask[id_ / 64];
+  if (table_.has_payload[id_] || table_.is_receiving_frame[id_] ||
+      ethernet_.IsBridgePort(id_)) {
+    word |= bit;
+  } else {
+    word &= ~bit;
+  }
 }
 
 void Station::ForceStopReceive() {
-  if (is_receiving_frame_) {
-    logger_.LogMessage(id_, "!!! frame receive interrupt");
+  if (table_.is_receiving_frame[id_]) {
+    logger_.LogMessage(id_, LogEvent::kReceiveInterrupt);
   }
-  is_receiving_frame_ = false;
+  table_.is_receiving_frame[id_] = false;
 }
 
 void Station::ForceStopSend() {
-  is_sending_frame_ = false;
-  retry_count_ = 0;
-  payload_queue_.pop();
+  table_.is_sending_frame[id_] = false;
+  table_.retry_counts[id_] = 0;
+  table_.payload_queues.Pop(id_);
+  if (table_.payload_queues.IsEmpty(id_)) {
+    table_.has_payload[id_] = false;
+    table_.payload_stations_count.fetch_sub(1, std::memory_order_relaxed);
+  }
   if (IsIdle()) {
-    logger_.LogMessage(id_, "nothing left to send");
+    logger_.LogMessage(id_, LogEvent::kNothingToSend);
   }
 }
 
+template std::optional<size_t>
+Station::ProcessTick<MacPolicy<Backoff::kExponential,
+                               Persistence::kNonPersistent>>();
+template std::optional<size_t>
+Station::ProcessTick<MacPolicy<Backoff::kExponential,
+                               Persistence::kOnePersistent>>();
+template std::optional<size_t>
+Station::ProcessTick<MacPolicy<Backoff::kExponential,
+                               Persistence::kPPersistent>>();
+template std::optional<size_t>
+Station::ProcessTick<MacPolicy<Backoff::kLinear,
+                               Persistence::kNonPersistent>>();
+template std::optional<size_t>
+Station::ProcessTick<MacPolicy<Backoff::kLinear,
+                               Persistence::kOnePersistent>>();
+template std::optional<size_t>
+Station::ProcessTick<MacPolicy<Backoff::kLinear, Persistence::kPPersistent>>();
+
 }  // namespace csma_cd
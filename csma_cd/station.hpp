@@ -1,11 +1,16 @@
 #pragma once
 
+#include <atomic>
 #include <optional>
-#include <queue>
 #include <random>
+#include <string_view>
+#include <vector>
 
+#include "checkpoint.hpp"
 #include "consts.hpp"
 #include "logger.hpp"
+#include "mac.hpp"
+#include "random.hpp"
 
 namespace csma_cd {
 
@@ -14,42 +19,208 @@ class Ethernet;
 struct Payload {
   size_t src_id;
   size_t dst_id;
-  std::string data;
+  // Points into loaded payload file
+  std::string_view data;
+  // Tick payload is queued at
+  uint64_t arrival_tick = 0;
 };
 
+// Payload sends frame to all stations if its destination id is stations
+// count, kBroadcastId or not less than both stations count and
+// kLegacyBroadcastId. Ids in [stations count, kLegacyBroadcastId) are errors
+bool IsBroadcastDst(size_t dst_id, size_t stations_count);
+
+// Payload queues of all stations sharing one pool of nodes. Station reuses
+// only nodes it freed itself, so stations may pop concurrently
+class PayloadQueues {
+ public:
+  explicit PayloadQueues(size_t stations_count);
+
+  bool IsEmpty(size_t station_id) const;
+
+  size_t Front(size_t station_id) const;
+
+  // Must not run concurrently with other calls
+  void Push(size_t station_id, size_t payload_id);
+
+  void Pop(size_t station_id);
+
+  // Calls function(payload_id) for payload queued by station from front
+  template <typename Function>
+  void ForEach(size_t station_id, Function function) const;
+
+  // Saves contents of queues, loaded queues get fresh pool of nodes
+  void Save(CheckpointWriter& writer) const;
+  void Load(CheckpointReader& reader);
+
+ private:
+  static constexpr uint32_t kNoNode = UINT32_MAX;
+
+  struct Node {
+    uint32_t payload_id;
+    uint32_t next;
+  };
+
+ private:
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> heads_;
+  std::vector<uint32_t> tails_;
+  // Lists of nodes freed by stations
+  std::vector<uint32_t> free_heads_;
+};
+
+// State of all stations accessed on every tick, stored column by column so
+// that scans over all stations touch only needed fields
+struct StationTable {
+  explicit StationTable(size_t stations_count);
+
+  bool IsIdle() const;
+
+  void SkipTicks(size_t ticks);
+
+  // Count of ticks after which some station acts regardless of bus events,
+  // nullopt if all stations only wait for bus events. Stations ready to send
+  // wait for them too if bus is awaited. Scan stops once delay is at most
+  // enough_delay
+  std::optional<size_t> GetWakeupDelay(bool is_bus_awaited,
+                                       size_t enough_delay) const;
+
+  // Ticks sleep timers and marks stations which are ready to send payload in
+  // ready_mask
+  void TickSleepTimers();
+
+  // Calls function(id) for stations from [begin, end) marked in ready_mask in
+  // ascending order of ids
+  template <typename Function>
+  void ForEachReady(size_t begin, size_t end, Function function) const;
+
+  // Calls function(id) for active stations from [begin, end) and for given
+  // station in ascending order of ids
+  template <typename Function>
+  void ForEachActive(size_t begin, size_t end, std::optional<size_t> extra_id,
+                     Function function) const;
+
+  // Ready mask is not saved, it is rebuilt on every tick before use
+  void Save(CheckpointWriter& writer) const;
+  void Load(CheckpointReader& reader);
+
+  std::vector<uint32_t> sleep_timers;
+  std::vector<uint32_t> retry_counts;
+  std::vector<uint8_t> is_receiving_frame;
+  std::vector<uint8_t> is_sending_frame;
+  // Mirrors whether payload queue of station is not empty
+  std::vector<uint8_t> has_payload;
+  // Bit per station, set if station is ready to send on current tick
+  std::vector<uint64_t> ready_mask;
+  // Bit per station, set if station has payload or receives frame, other
+  // stations can only react on frames sent to them. Station updates its bit
+  // itself, so threads must process whole words
+  std::vector<uint64_t> active_mask;
+  std::atomic<size_t> payload_stations_count;
+
+  PayloadQueues payload_queues;
+};
+
+namespace internal {
+
+// Calls function(id) for bits of mask set in [begin, end), word of mask is
+// read before calling function for its bits
+template <typename Mask, typename Function>
+void ForEachMarked(size_t begin, size_t end, Mask mask, Function function) {
+  for (size_t word = begin / 64; word * 64 < end; ++word) {
+    uint64_t bits = mask(word);
+    if (word == begin / 64) {
+      bits &= ~uint64_t{0} << (begin % 64);
+    }
+    if ((word + 1) * 64 > end) {
+      bits &= (uint64_t{1} << (end % 64)) - 1;
+    }
+    while (bits) {
+      function(word * 64 + __builtin_ctzll(bits));
+      bits &= bits - 1;
+    }
+  }
+}
+
+}  // namespace internal
+
+template <typename Function>
+void PayloadQueues::ForEach(size_t station_id, Function function) const {
+  for (uint32_t node = heads_[station_id]; node != kNoNode;
+       node = nodes_[node].next) {
+    function(nodes_[node].payload_id);
+  }
+}
+
+template <typename Function>
+void StationTable::ForEachReady(size_t begin, size_t end,
+                                Function function) const {
+  internal::ForEachMarked(
+      begin, end, [this](size_t word) { return ready_mask[word]; }, function);
+}
+
+template <typename Function>
+void StationTable::ForEachActive(size_t begin, size_t end,
+                                 std::optional<size_t> extra_id,
+                                 Function function) const {
+  internal::ForEachMarked(
+      begin, end,
+      [this, extra_id](size_t word) {
+        uint64_t bits = active_mask[word];
+        if (extra_id && *extra_id / 64 == word) {
+          bits |= uint64_t{1} << (*extra_id % 64);
+        }
+        return bits;
+      },
+      function);
+}
+
+// Rarely accessed state of station and logic working with state in table
 class Station {
  public:
-  Station(size_t id, const Ethernet& ethernet, int rand_seed);
+  Station(size_t id, StationTable& table, const Ethernet& ethernet,
+          Logger& logger, const MacParams& mac, const Random& rand_gen);
 
-  void AddPayload(Payload&& payload);
+  void AddPayload(size_t payload_id);
 
   bool IsIdle() const;
 
-  std::optional<Payload> ProcessTick();
+  // Returns id of payload if station starts sending it, policy must match
+  // MAC config
+  template <typename Policy>
+  std::optional<size_t> ProcessTick();
+
+  // State kept outside of table
+  void Save(CheckpointWriter& writer) const;
+  void Load(CheckpointReader& reader);
 
  private:
   void ProcessReceive();
 
-  std::optional<Payload> ProcessSend();
+  template <typename Policy>
+  std::optional<size_t> ProcessSend();
 
+  template <typename Policy>
   void StartSleep();
 
+  // Logs event about payload in front of queue
+  void LogPayload(LogEvent event);
+
+  // Marks station in active mask if it has payload or receives frame
+  void UpdateActivity();
+
   void ForceStopReceive();
 
   void ForceStopSend();
 
  private:
   const size_t id_;
-  std::queue<Payload> payload_queue_;
-
-  size_t sleep_timer_;
-  bool is_receiving_frame_;
-  bool is_sending_frame_;
-  size_t retry_count_;
 
-  std::mt19937 rand_gen_;
+  Random rand_gen_;
+  StationTable& table_;
   const Ethernet& ethernet_;
-  mutable Logger logger_;
+  Logger& logger_;
+  const MacParams& mac_;
 };
 
 }  // namespace csma_cd
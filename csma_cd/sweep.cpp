@@ -0,0 +1,145 @@
+#include "sweep.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <mutex>
+#include <stdexcept>
+
+#include "random.hpp"
+#include "worker_pool.hpp"
+
+namespace csma_cd {
+
+namespace {
+
+enum SweepMetric {
+  kOfferedLoad,
+  kUtilization,
+  kCollisionRate,
+  kDropRate,
+  kDelayMean,
+  kDelayP99,
+  kFairness,
+  kSweepMetricsCount,
+};
+
+constexpr std::array<const char*, kSweepMetricsCount> kSweepMetricNames = {
+    "offered_load", "utilization", "collision_rate", "drop_rate",
+    "delay_mean",   "delay_p99",   "fairness"};
+
+using SweepResult = std::array<double, kSweepMetricsCount>;
+
+// 97.5% quantile of Student's t-distribution
+double GetStudentQuantile(size_t degrees_of_freedom) {
+  static constexpr std::array<double, 30> kQuantiles = {
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+      2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+      2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+  if (degrees_of_freedom == 0) {
+    return NAN;
+  }
+  if (degrees_of_freedom <= kQuantiles.size()) {
+    return kQuantiles[degrees_of_freedom - 1];
+  }
+  return 1.96;
+}
+
+SweepResult RunReplication(const SimulationConfig& config) {
+  Simulation simulation(config);
+  simulation.RunUntilIdle();
+
+  const Metrics& metrics = *simulation.GetMetrics();
+  const uint64_t finished_frames =
+      metrics.GetSentFrames() + metrics.GetDroppedFrames();
+  SweepResult result{};
+  result[kOfferedLoad] = metrics.GetOfferedLoad();
+  result[kUtilization] = metrics.GetChannelUtilization();
+  result[kCollisionRate] = metrics.GetCollisionRate();
+  result[kDropRate] =
+      finished_frames ? static_cast<double>(metrics.GetDroppedFrames()) /
+                            finished_frames
+                      : 0;
+  result[kDelayMean] = metrics.GetAccessDelay().GetMean();
+  result[kDelayP99] = metrics.GetAccessDelay().GetPercentile(0.99);
+  result[kFairness] = metrics.GetFairnessIndex();
+  return result;
+}
+
+}  // namespace
+
+void RunSweep(const SweepConfig& config, std::ostream& report) {
+  if (config.replications == 0 ||
+      config.ethernet_config.traffic.duration == 0) {
+    throw std::invalid_argument(
+        "Bad sweep: replications and traffic duration must be positive");
+  }
+
+  const size_t loads_count = config.offered_loads.size();
+  const size_t jobs_count =
+      config.stations_counts.size() * loads_count * config.replications;
+  std::vector<SweepResult> results(jobs_count);
+  std::atomic<size_t> next_job(0);
+  std::exception_ptr error;
+  std::mutex error_mutex;
+
+  WorkerPool workers(std::max<size_t>(1, config.threads_count));
+  workers.Run([&](size_t) {
+    for (size_t job = next_job++; job < jobs_count; job = next_job++) {
+      const size_t group = job / config.replications;
+      SimulationConfig simulation_config;
+      simulation_config.stations_count =
+          config.stations_counts[group / loads_count];
+      auto& ethernet_config = simulation_config.ethernet;
+      ethernet_config = config.ethernet_config;
+      ethernet_config.threads_count = 1;
+      ethernet_config.collect_metrics = true;
+      ethernet_config.traffic.offered_load =
+          config.offered_loads[group % loads_count];
+      ethernet_config.seed = Random(config.seed, job)();
+      try {
+        results[job] = RunReplication(simulation_config);
+      } catch (...) {
+        const std::lock_guard<std::mutex> lock(error_mutex);
+        error = std::current_exception();
+      }
+    }
+  });
+  if (error) {
+    std::rethrow_exception(error);
+  }
+
+  report << "stations,load,replications";
+  for (const char* name : kSweepMetricNames) {
+    report << ',' << name << "_mean," << name << "_ci";
+  }
+  report << '\n';
+  for (size_t group = 0; group * config.replications < jobs_count; ++group) {
+    report << config.stations_counts[group / loads_count] << ','
+           << config.offered_loads[group % loads_count] << ','
+           << config.replications;
+    const auto* group_results = &results[group * config.replications];
+    for (size_t metric = 0; metric < kSweepMetricsCount; ++metric) {
+      double sum = 0;
+      for (size_t i = 0; i < config.replications; ++i) {
+        sum += group_results[i][metric];
+      }
+      const double mean = sum / config.replications;
+      double square_deviations = 0;
+      for (size_t i = 0; i < config.replications; ++i) {
+        square_deviations += std::pow(group_results[i][metric] - mean, 2);
+      }
+      // Half-width of interval, undefined for single replication
+      const double deviation =
+          std::sqrt(square_deviations / (config.replications - 1));
+      const double half_width = GetStudentQuantile(config.replications - 1) *
+                                deviation / std::sqrt(config.replications);
+      report << ',' << mean << ',' << half_width;
+    }
+    report << '\n';
+  }
+}
+
+}  // namespace csma_cd
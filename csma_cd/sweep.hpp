@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "simulation.hpp"
+
+namespace csma_cd {
+
+struct SweepConfig {
+  std::vector<size_t> stations_counts;
+  std::vector<double> offered_loads;
+  size_t replications = 10;
+  // Seeds of replications are derived from it, so report does not depend on
+  // threads count
+  uint64_t seed = 0;
+  // Count of simulations running concurrently
+  size_t threads_count = 1;
+  // Config of every simulation with generated traffic, its load, seed, log
+  // and threads are overridden
+  EthernetConfig ethernet_config;
+};
+
+// Runs replications for every pair of stations count and load, writes CSV
+// with mean and 95% confidence interval of metrics for every pair
+void RunSweep(const SweepConfig& config, std::ostream& report);
+
+}  // namespace csma_cd
@@ -15,7 +15,7 @@ def main(argv):
     for _ in range(samples_count):
         src_id = random.randint(0, stations_count - 1)
         dst_id = (
-            1024
+            stations_count
             if random.choices([True, False], weights=[0.1, 0.9])[0]
             else random.randint(0, stations_count - 1)
         )
@@ -0,0 +1,138 @@
+#include "traffic.hpp"
+
+#include <stdexcept>
+#include <string>
+
+#include "frame.hpp"
+
+namespace csma_cd {
+
+namespace {
+
+// Lowercase letters repeated to the longest frame data
+std::string MakeGeneratedData() {
+  std::string data(kMaxDataLength, 0);
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<char>('a' + i % 26);
+  }
+  return data;
+}
+
+}  // namespace
+
+std::string_view GetGeneratedData(size_t length) {
+  static const std::string data = MakeGeneratedData();
+  return std::string_view(data).substr(0, length);
+}
+
+TrafficGenerator::TrafficGenerator(size_t stations_count,
+                                   const TrafficConfig& config,
+                                   const Random& rand_gen)
+    : config_(config),
+      stations_count_(stations_count),
+      mean_gap_(stations_count * GetFrameLengthInTicks(config.data_length) /
+                config.offered_load),
+      rand_gen_(rand_gen),
+      sources_(stations_count) {
+  if (config_.offered_load <= 0 || config_.mean_burst <= 0) {
+    throw std::invalid_argument(
+        "Bad traffic: offered load and burst length must be positive");
+  }
+  // Traffic without duration would end before first arrival
+  if (!config_.duration) {
+    throw std::invalid_argument("Bad traffic: duration must be positive");
+  }
+  if (config_.data_length > kMaxDataLength) {
+    throw std::invalid_argument(
+        "Bad traffic: data length must be less than 1500");
+  }
+
+  std::exponential_distribution<double> period(1 / config_.mean_burst);
+  std::uniform_real_distribution<double> phase(0, mean_gap_);
+  for (size_t id = 0; id < stations_count_; ++id) {
+    auto& source = sources_[id];
+    source.next_arrival = 0;
+    source.on_period_end = period(rand_gen_);
+    // Stations must not send constant traffic in lockstep
+    if (config_.pattern == TrafficPattern::kConstant) {
+      source.next_arrival = phase(rand_gen_);
+    } else {
+      source.next_arrival = DrawNextArrival(source);
+    }
+    Schedule(id);
+  }
+}
+
+std::optional<uint64_t> TrafficGenerator::GetNextArrival() const {
+  if (arrivals_.empty()) {
+    return std::nullopt;
+  }
+  return arrivals_.top().first;
+}
+
+Payload TrafficGenerator::PopArrival() {
+  const auto [arrival_tick, id] = arrivals_.top();
+  arrivals_.pop();
+
+  // Frames go to random other station, single station can only broadcast
+  size_t dst_id = kBroadcastId;
+  if (stations_count_ > 1) {
+    dst_id = std::uniform_int_distribution<size_t>(0, stations_count_ - 2)(
+        rand_gen_);
+    dst_id += dst_id >= id;
+  }
+
+  auto& source = sources_[id];
+  source.next_arrival = DrawNextArrival(source);
+  Schedule(id);
+  return {id, dst_id, GetGeneratedData(config_.data_length), arrival_tick};
+}
+
+void TrafficGenerator::Save(CheckpointWriter& writer) const {
+  writer.Write(rand_gen_);
+  writer.WriteArray(sources_.data(), sources_.size());
+}
+
+void TrafficGenerator::Load(CheckpointReader& reader) {
+  reader.Read(rand_gen_);
+  reader.ReadArray(sources_.data(), sources_.size());
+  arrivals_ = {};
+  for (size_t id = 0; id < stations_count_; ++id) {
+    Schedule(id);
+  }
+}
+
+double TrafficGenerator::DrawNextArrival(Source& source) {
+  switch (config_.pattern) {
+    case TrafficPattern::kPoisson:
+      return source.next_arrival +
+             std::exponential_distribution<double>(1 / mean_gap_)(rand_gen_);
+    case TrafficPattern::kOnOff: {
+      // Half of time is silent, so bursts are twice as dense
+      std::exponential_distribution<double> gap(2 / mean_gap_);
+      std::exponential_distribution<double> period(1 / config_.mean_burst);
+      double arrival = source.next_arrival + gap(rand_gen_);
+      // Gaps are memoryless, so arrival falling into silence is drawn again
+      // from start of next burst
+      while (arrival >= source.on_period_end) {
+        const double on_period_start =
+            source.on_period_end + period(rand_gen_);
+        source.on_period_end = on_period_start + period(rand_gen_);
+        arrival = on_period_start + gap(rand_gen_);
+      }
+      return arrival;
+    }
+    case TrafficPattern::kConstant:
+      return source.next_arrival + mean_gap_;
+  }
+  return source.next_arrival;
+}
+
+void TrafficGenerator::Schedule(size_t id) {
+  const double arrival = sources_[id].next_arrival;
+  if (arrival < config_.duration) {
+    arrivals_.emplace(static_cast<uint64_t>(arrival), id);
+  }
+}
+
+}  // namespace csma_cd
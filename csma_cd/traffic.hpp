@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <queue>
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "checkpoint.hpp"
+#include "random.hpp"
+#include "station.hpp"
+
+namespace csma_cd {
+
+enum class TrafficPattern {
+  kPoisson,   // exponential gaps between frames
+  kOnOff,     // Poisson bursts separated by silence of the same mean length
+  kConstant,  // equal gaps, random phase per station
+};
+
+struct TrafficConfig {
+  TrafficPattern pattern = TrafficPattern::kPoisson;
+  // Frames offered by all stations per time of sending one frame, 0 disables
+  // traffic
+  double offered_load = 0;
+  // Ticks during which frames arrive, must be set with offered load
+  uint64_t duration = 0;
+  // Mean length of on and off periods in ticks
+  double mean_burst = 1000;
+  size_t data_length = kMaxDataLength;
+};
+
+// Data of generated frame, generated frames are rendered in logs from their
+// length only
+std::string_view GetGeneratedData(size_t length);
+
+// Creates frames of all stations lazily in order of their arrival
+class TrafficGenerator {
+ public:
+  TrafficGenerator(size_t stations_count, const TrafficConfig& config,
+                   const Random& rand_gen);
+
+  // Tick of next arrival, nullopt if traffic is over
+  std::optional<uint64_t> GetNextArrival() const;
+
+  // Creates frame arriving next
+  Payload PopArrival();
+
+  // Schedule of arrivals is rebuilt from loaded sources
+  void Save(CheckpointWriter& writer) const;
+  void Load(CheckpointReader& reader);
+
+ private:
+  // Frame source of one station
+  struct Source {
+    // Time of next arrival in ticks
+    double next_arrival;
+    // End of current on period for on/off traffic
+    double on_period_end;
+  };
+
+  double DrawNextArrival(Source& source);
+
+  void Schedule(size_t id);
+
+ private:
+  const TrafficConfig config_;
+  const size_t stations_count_;
+  // Mean gap between frames of one station in ticks
+  const double mean_gap_;
+  Random rand_gen_;
+  std::vector<Source> sources_;
+  // Min-heap of (arrival tick, station id)
+  std::priority_queue<std::pair<uint64_t, size_t>,
+                      std::vector<std::pair<uint64_t, size_t>>, std::greater<>>
+      arrivals_;
+};
+
+}  // namespace csma_cd
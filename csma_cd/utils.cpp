@@ -1,8 +1,15 @@
 #include "utils.hpp"
 
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define CSMA_CD_HAS_CLMUL_CRC32
+#include <immintrin.h>
+#endif
+
 namespace {
 
-uint32_t crc32_table[] = {
+constexpr uint32_t crc32_table[] = {
     0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
     0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
     0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
@@ -47,6 +54,142 @@ uint32_t crc32_table[] = {
     0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
     0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d};
 
+// Tables for slicing-by-8: table[k][b] is CRC of byte b followed by k zeros
+using SlicingTables = std::array<std::array<uint32_t, 256>, 8>;
+
+constexpr SlicingTables MakeSlicingTables() {
+  SlicingTables tables{};
+  for (size_t i = 0; i < 256; ++i) {
+    tables[0][i] = crc32_table[i];
+  }
+  for (size_t k = 1; k < tables.size(); ++k) {
+    for (size_t i = 0; i < 256; ++i) {
+      const uint32_t prev = tables[k - 1][i];
+      tables[k][i] = crc32_table[prev & 0xffu] ^ (prev >> 8u);
+    }
+  }
+  return tables;
+}
+
+constexpr SlicingTables crc32_slicing_tables = MakeSlicingTables();
+
+// Functions below work with raw CRC register (without final inversion)
+
+uint32_t UpdateBytewise(uint32_t crc, const uint8_t* data, size_t size) {
+  while (size--) {
+    crc = crc32_table[(crc ^ *data++) & 0xffu] ^ (crc >> 8u);
+  }
+  return crc;
+}
+
+uint32_t UpdateSlicingBy8(uint32_t crc, const uint8_t* data, size_t size) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  const auto& t = crc32_slicing_tables;
+  while (size >= 8) {
+    uint32_t low;
+    uint32_t high;
+    std::memcpy(&low, data, 4);
+    std::memcpy(&high, data + 4, 4);
+    low ^= crc;
+    crc = t[7][low & 0xffu] ^ t[6][(low >> 8u) & 0xffu] ^
+          t[5][(low >> 16u) & 0xffu] ^ t[4][low >> 24u] ^
+          t[3][high & 0xffu] ^ t[2][(high >> 8u) & 0xffu] ^
+          t[1][(high >> 16u) & 0xffu] ^ t[0][high >> 24u];
+    data += 8;
+    size -= 8;
+  }
+#endif
+  return UpdateBytewise(crc, data, size);
+}
+
+#ifdef CSMA_CD_HAS_CLMUL_CRC32
+
+/* Folds 16-byte blocks with carry-less multiplication, see Intel paper "Fast
+ * CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction".
+ * Constants are for bit-reflected CRC-32 polynomial 0x04c11db7.
+ * Requires size >= 64 and size % 16 == 0. */
+__attribute__((target("pclmul,sse4.1"))) uint32_t UpdateClmul(
+    uint32_t crc, const uint8_t* data, size_t size) {
+  alignas(16) static constexpr uint64_t k1k2[] = {0x0154442bd4, 0x01c6e41596};
+  alignas(16) static constexpr uint64_t k3k4[] = {0x01751997d0, 0x00ccaa009e};
+  alignas(16) static constexpr uint64_t k5k0[] = {0x0163cd6124, 0x0000000000};
+  alignas(16) static constexpr uint64_t poly[] = {0x01db710641, 0x01f7011641};
+
+  __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+  __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16));
+  __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 32));
+  __m128i x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 48));
+  x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+  data += 64;
+  size -= 64;
+
+  // Fold 4 blocks in parallel
+  __m128i k = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+  while (size >= 64) {
+    const __m128i x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+    const __m128i x6 = _mm_clmulepi64_si128(x2, k, 0x00);
+    const __m128i x7 = _mm_clmulepi64_si128(x3, k, 0x00);
+    const __m128i x8 = _mm_clmulepi64_si128(x4, k, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+    x2 = _mm_clmulepi64_si128(x2, k, 0x11);
+    x3 = _mm_clmulepi64_si128(x3, k, 0x11);
+    x4 = _mm_clmulepi64_si128(x4, k, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(data)));
+    x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(data + 16)));
+    x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(data + 32)));
+    x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(data + 48)));
+    data += 64;
+    size -= 64;
+  }
+
+  // Fold 4 blocks into one
+  k = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+  for (const __m128i next : {x2, x3, x4}) {
+    const __m128i x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, next), x5);
+  }
+
+  // Fold remaining blocks one by one
+  while (size >= 16) {
+    const __m128i x5 = _mm_clmulepi64_si128(x1, k, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, k, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(
+        reinterpret_cast<const __m128i*>(data)));
+    data += 16;
+    size -= 16;
+  }
+
+  // Fold 128 bits to 64 bits
+  const __m128i mask = _mm_setr_epi32(~0, 0, ~0, 0);
+  __m128i high = _mm_clmulepi64_si128(x1, k, 0x10);
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), high);
+  k = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+  high = _mm_srli_si128(x1, 4);
+  x1 = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), k, 0x00);
+  x1 = _mm_xor_si128(x1, high);
+
+  // Barrett reduction to 32 bits
+  k = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+  __m128i reduced = _mm_clmulepi64_si128(_mm_and_si128(x1, mask), k, 0x10);
+  reduced = _mm_clmulepi64_si128(_mm_and_si128(reduced, mask), k, 0x00);
+  x1 = _mm_xor_si128(x1, reduced);
+  return static_cast<uint32_t>(_mm_extract_epi32(x1, 1));
+}
+
+#endif
+
+using CRC32Function = uint32_t (*)(uint32_t, const uint8_t*, size_t);
+
+// Chosen once on startup according to CPU features
+const CRC32Function crc32_impl = csma_cd::utils::HasClmulCRC32()
+                                     ? csma_cd::utils::CRC32Clmul
+                                     : csma_cd::utils::CRC32SlicingBy8;
+
 }  // namespace
 
 namespace csma_cd::utils {
@@ -56,8 +199,8 @@ void InsertAddress(size_t id, std::array<csma_cd::Byte, 6>& address) {
     address = kBroadcastAddress;
   } else {
     for (size_t i = 5; i >= 3; --i) {
-      address[i] = id & 0x0fu;
-      id >>= 4u;
+      address[i] = id & 0xffu;
+      id >>= 8u;
     }
   }
 }
@@ -68,23 +211,51 @@ std::optional<size_t> ExctractId(const std::array<csma_cd::Byte, 6>& address) {
       address[2] != 0xba) {
     return std::nullopt;
   }
+  // Broadcast bit makes second half of address meaningless
+  if (address[0] >> 7u) {
+    return kBroadcastId;
+  }
 
   // Decode second half of address
   size_t id = 0;
   for (size_t i = 3; i < 6; ++i) {
-    id <<= 4u;
+    id <<= 8u;
     id |= address[i];
   }
   return id;
 }
 
 uint32_t CRC32(uint32_t crc, const uint8_t* data, size_t size) {
-  crc = crc ^ ~0u;
-  auto p = data;
-  while (size--) {
-    crc = crc32_table[(crc ^ *p++) & 0xffu] ^ (crc >> 8u);
+  return crc32_impl(crc, data, size);
+}
+
+uint32_t CRC32Bytewise(uint32_t crc, const uint8_t* data, size_t size) {
+  return UpdateBytewise(crc ^ ~0u, data, size) ^ ~0u;
+}
+
+uint32_t CRC32SlicingBy8(uint32_t crc, const uint8_t* data, size_t size) {
+  return UpdateSlicingBy8(crc ^ ~0u, data, size) ^ ~0u;
+}
+
+bool HasClmulCRC32() {
+#ifdef CSMA_CD_HAS_CLMUL_CRC32
+  return __builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1");
+#else
+  return false;
+#endif
+}
+
+uint32_t CRC32Clmul(uint32_t crc, const uint8_t* data, size_t size) {
+  crc ^= ~0u;
+#ifdef CSMA_CD_HAS_CLMUL_CRC32
+  if (size >= 64) {
+    const size_t folded_size = size & ~size_t{15};
+    crc = UpdateClmul(crc, data, folded_size);
+    data += folded_size;
+    size -= folded_size;
   }
-  return crc ^ ~0u;
+#endif
+  return UpdateSlicingBy8(crc, data, size) ^ ~0u;
 }
 
 }  // namespace csma_cd::utils
@@ -11,6 +11,14 @@ void InsertAddress(size_t id, std::array<csma_cd::Byte, 6>& address);
 
 std::optional<size_t> ExctractId(const std::array<csma_cd::Byte, 6>& address);
 
+// Uses fastest implementation supported by CPU
 uint32_t CRC32(uint32_t crc, const uint8_t* data, size_t size);
 
+// Implementations below give the same result, they are exposed for benchmarks
+uint32_t CRC32Bytewise(uint32_t crc, const uint8_t* data, size_t size);
+uint32_t CRC32SlicingBy8(uint32_t crc, const uint8_t* data, size_t size);
+// PCLMULQDQ folding, can be called only if HasClmulCRC32() returns true
+bool HasClmulCRC32();
+uint32_t CRC32Clmul(uint32_t crc, const uint8_t* data, size_t size);
+
 }  // namespace csma_cd::utils
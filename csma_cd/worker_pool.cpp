@@ -0,0 +1,94 @@
+#include "worker_pool.hpp"
+
+#include <stdexcept>
+
+namespace csma_cd {
+
+namespace {
+
+// Tasks of one tick take microseconds, longer waits are slept through
+constexpr size_t kSpinCount = 4096;
+
+}  // namespace
+
+WorkerPool::WorkerPool(size_t threads_count)
+    : task_(nullptr),
+      task_function_(nullptr),
+      generation_(0),
+      running_count_(0),
+      is_stopped_(false),
+      blocked_count_(0) {
+  if (threads_count == 0) {
+    throw std::invalid_argument("Threads count must be positive");
+  }
+  for (size_t index = 1; index < threads_count; ++index) {
+    threads_.emplace_back(&WorkerPool::WorkerLoop, this, index);
+  }
+}
+
+WorkerPool::~WorkerPool() {
+  is_stopped_ = true;
+  ++generation_;
+  Notify();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+size_t WorkerPool::GetThreadsCount() const { return threads_.size() + 1; }
+
+void WorkerPool::RunTask(const void* task, TaskFunction function) {
+  task_ = task;
+  task_function_ = function;
+  running_count_ = threads_.size();
+  ++generation_;
+  Notify();
+
+  function(task, 0);
+
+  Wait([this] { return running_count_ == 0; });
+}
+
+void WorkerPool::WorkerLoop(size_t index) {
+  size_t seen_generation = 0;
+  while (true) {
+    Wait([&] { return generation_ != seen_generation; });
+    ++seen_generation;
+    if (is_stopped_) {
+      return;
+    }
+
+    task_function_(task_, index);
+
+    if (--running_count_ == 0) {
+      Notify();
+    }
+  }
+}
+
+template <typename Condition>
+void WorkerPool::Wait(Condition condition) {
+  for (size_t i = 0; i < kSpinCount; ++i) {
+    if (condition()) {
+      return;
+    }
+    std::this_thread::yield();
+  }
+  std::unique_lock lock(mutex_);
+  // Notifier checks blocked count after changing state, so either it sees
+  // this thread blocked or this thread sees the change
+  ++blocked_count_;
+  state_changed_.wait(lock, condition);
+  --blocked_count_;
+}
+
+void WorkerPool::Notify() {
+  if (blocked_count_ == 0) {
+    return;
+  }
+  // Thread which has counted itself blocked releases mutex only in wait
+  { std::lock_guard lock(mutex_); }
+  state_changed_.notify_all();
+}
+
+}  // namespace csma_cd
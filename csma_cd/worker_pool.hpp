@@ -0,0 +1,64 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace csma_cd {
+
+// Fixed set of threads running the same task with different thread indices
+class WorkerPool {
+ public:
+  // Calling thread counts as one of threads
+  explicit WorkerPool(size_t threads_count);
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  ~WorkerPool();
+
+  size_t GetThreadsCount() const;
+
+  // Runs task(i) for every thread index i, returns when all calls are done
+  template <typename Task>
+  void Run(const Task& task);
+
+ private:
+  using TaskFunction = void (*)(const void*, size_t);
+
+  void RunTask(const void* task, TaskFunction function);
+
+  void WorkerLoop(size_t index);
+
+  // Spins for a while and then blocks until condition holds, so short tasks
+  // run every tick do not pay for sleeping
+  template <typename Condition>
+  void Wait(Condition condition);
+  // Wakes threads blocked in Wait after state they wait for has changed
+  void Notify();
+
+ private:
+  std::vector<std::thread> threads_;
+
+  // Task is published by incrementing generation
+  const void* task_;
+  TaskFunction task_function_;
+  std::atomic<size_t> generation_;
+  std::atomic<size_t> running_count_;
+  std::atomic<bool> is_stopped_;
+
+  std::mutex mutex_;
+  std::condition_variable state_changed_;
+  std::atomic<size_t> blocked_count_;
+};
+
+template <typename Task>
+void WorkerPool::Run(const Task& task) {
+  RunTask(&task, [](const void* task, size_t index) {
+    (*static_cast<const Task*>(task))(index);
+  });
+}
+
+}  // namespace csma_cd